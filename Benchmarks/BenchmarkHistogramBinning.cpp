@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "histogrambinning.h"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+
+
+namespace {
+    constexpr int REPETITIONS = 5;
+    constexpr int NUMBER_OF_BINS = 1024;
+
+    //Returns the best run time of the functor in milliseconds
+    template<typename Functor>
+    double measure(Functor&& functor)
+    {
+        double best = std::numeric_limits<double>::max();
+        for(int i = 0; i < REPETITIONS; i++){
+            const int64_t start = cv::getTickCount();
+            functor();
+            best = std::min(best, (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+        }
+        return best;
+    }
+
+    void benchmarkDepth(const int depth, const char* depthName)
+    {
+        //A 100 MPix frame
+        cv::Mat frame(10000, 10000, depth);
+        cv::randu(frame, 0, 60000);
+
+        const double calcHistTime = measure([&](){
+            double minVal{};
+            double maxVal{};
+            cv::minMaxLoc(frame, &minVal, &maxVal);
+
+            cv::Mat hist;
+            const std::vector<float> ranges{static_cast<float>(minVal), static_cast<float>(maxVal)};
+            cv::calcHist(std::vector<cv::Mat>{frame}, {0}, cv::Mat(), hist, {NUMBER_OF_BINS}, ranges, true);
+        });
+        std::cout << depthName << " minMaxLoc + calcHist: " << calcHistTime << " ms" << std::endl;
+
+        for(int threads = 1; threads <= cv::getNumberOfCPUs(); threads *= 2){
+            const double binningTime = measure([&](){
+                const auto[minVal, maxVal] = HistogramBinning::minMax(frame, threads);
+                HistogramBinning::countBins(frame, NUMBER_OF_BINS, static_cast<float>(minVal), static_cast<float>(maxVal), threads);
+            });
+            std::cout << depthName << " HistogramBinning, " << threads << " thread(s): " << binningTime << " ms (x" << calcHistTime / binningTime << ")" << std::endl;
+        }
+    }
+}
+
+auto main() -> int
+{
+    benchmarkDepth(CV_16U, "CV_16U");
+    benchmarkDepth(CV_32F, "CV_32F");
+}
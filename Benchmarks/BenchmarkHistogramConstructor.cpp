@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "histogram.h"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+
+
+namespace {
+    constexpr int REPETITIONS = 5;
+    constexpr int NUMBER_OF_BINS = 1024;
+
+    //Returns the best run time of the functor in milliseconds
+    template<typename Functor>
+    double measure(Functor&& functor)
+    {
+        double best = std::numeric_limits<double>::max();
+        for(int i = 0; i < REPETITIONS; i++){
+            const int64_t start = cv::getTickCount();
+            functor();
+            best = std::min(best, (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+        }
+        return best;
+    }
+
+    //The constructor before the binning engine: minMaxLoc for the range, calcHist for the counts and a copy of the float counts
+    std::vector<size_t> calcHistConstructor(const cv::Mat& frame)
+    {
+        double minVal{};
+        double maxVal{};
+        cv::minMaxLoc(frame, &minVal, &maxVal);
+
+        cv::Mat hist;
+        const std::vector<float> ranges{static_cast<float>(minVal), static_cast<float>(maxVal)};
+        cv::calcHist(std::vector<cv::Mat>{frame}, {0}, cv::Mat(), hist, {NUMBER_OF_BINS}, ranges, true);
+        return std::vector<size_t>(hist.begin<float>(), hist.end<float>());
+    }
+
+    void benchmarkDepth(const int depth, const char* depthName)
+    {
+        //A 100 MPix frame with a few values that have to be rejected
+        cv::Mat frame(10000, 10000, depth);
+        cv::randu(frame, -1000, 1000);
+        frame.row(0).setTo(std::numeric_limits<float>::quiet_NaN());
+
+        //cv::calcHist only supports CV_32F among the floating point depths
+        const double calcHistTime = (depth == CV_32F)? measure([&](){ calcHistConstructor(frame); }) : 0.0;
+        if(depth == CV_32F)
+            std::cout << depthName << " minMaxLoc + calcHist: " << calcHistTime << " ms" << std::endl;
+
+        const int defaultThreads = cv::getNumThreads();
+        for(const int threads : {1, defaultThreads}){
+            cv::setNumThreads(threads);
+            const double constructorTime = measure([&](){ Histogram(frame, NUMBER_OF_BINS); });
+            std::cout << depthName << " Histogram constructor, " << threads << " thread(s): " << constructorTime << " ms";
+            if(calcHistTime > 0)
+                std::cout << " (x" << calcHistTime / constructorTime << ")";
+            std::cout << std::endl;
+        }
+        cv::setNumThreads(defaultThreads);
+    }
+}
+
+auto main() -> int
+{
+    benchmarkDepth(CV_32F, "CV_32F");
+    benchmarkDepth(CV_64F, "CV_64F");
+}
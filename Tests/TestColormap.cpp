@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "colormap.h"
+#include "colormapkernel.h"
+#include <limits>
 
 
 class GradientMat : public testing::Test
@@ -85,3 +87,347 @@ TEST_F(GradientMat, ConstructorDefaultMaximumGenerateTest)
     Colormap cmap(getMat(), 50, {});
     ASSERT_NO_THROW(cmap.generate());
 }
+
+namespace {
+    //Colors that repeat the index in every channel, so the colorized array shows the indices
+    cv::Mat identityLookupTable()
+    {
+        cv::Mat colors(1, ColormapKernel::LOOKUP_TABLE_SIZE, CV_8UC3);
+        for(int i = 0; i < colors.cols; i++){
+            colors.at<cv::Vec3b>(i) = cv::Vec3b(i, i, i);
+        }
+        return colors;
+    }
+}
+
+class KernelInput : public testing::TestWithParam<int>
+{
+public:
+    void SetUp() override{
+        data = cv::Mat(301, 257, GetParam());
+        cv::randu(data, 0, 200);
+    };
+    cv::Mat getMat() const {return data;};
+
+private:
+    cv::Mat data;
+};
+
+TEST_P(KernelInput, MatchesNormalizeTest)
+{
+    //Reference of the previous implementation: truncate, then normalize the truncated values
+    cv::Mat truncated = cv::max(cv::min(getMat(), 150), 30);
+    cv::Mat expected;
+    cv::normalize(truncated, expected, 0, UCHAR_MAX, cv::NormTypes::NORM_MINMAX, CV_8U);
+
+    double truncatedMin{};
+    double truncatedMax{};
+    cv::minMaxLoc(truncated, &truncatedMin, &truncatedMax);
+
+    for(const int parallelism : {1, 3, 0}){
+        cv::Mat colorized;
+        ColormapKernel::colorize(getMat(), truncatedMin, truncatedMax, identityLookupTable(), colorized, parallelism);
+        ASSERT_EQ(CV_8UC3, colorized.type());
+
+        //Rounding of the scaled values may differ by the last bit
+        cv::Mat indices;
+        cv::extractChannel(colorized, indices, 0);
+        EXPECT_LE(cv::norm(indices, expected, cv::NORM_INF), 1.0);
+    }
+}
+
+TEST_P(KernelInput, NonContinuousTest)
+{
+    const cv::Mat roi = getMat()(cv::Rect(3, 5, 200, 250));
+    ASSERT_FALSE(roi.isContinuous());
+
+    cv::Mat expected;
+    ColormapKernel::colorize(roi.clone(), 10, 190, ColormapKernel::lookupTable(cv::COLORMAP_JET), expected, 1);
+    cv::Mat colorized;
+    ColormapKernel::colorize(roi, 10, 190, ColormapKernel::lookupTable(cv::COLORMAP_JET), colorized, 4);
+    EXPECT_EQ(0, cv::norm(expected, colorized, cv::NORM_INF));
+}
+
+INSTANTIATE_TEST_SUITE_P(ColormapTest, KernelInput, testing::Values(CV_8U, CV_16U, CV_16S, CV_32S, CV_32F, CV_64F));
+
+TEST(ColormapTest, KernelLookupTableTest)
+{
+    cv::Mat target(1, 256, CV_8U);
+    for(int i = 0; i < target.cols; i++){
+        target.at<uchar>(i) = static_cast<uchar>(i);
+    }
+
+    cv::Mat expected;
+    cv::applyColorMap(target, expected, cv::COLORMAP_VIRIDIS);
+    cv::Mat colorized;
+    ColormapKernel::colorize(target, 0, 255, ColormapKernel::lookupTable(cv::COLORMAP_VIRIDIS), colorized);
+    EXPECT_EQ(0, cv::norm(expected, colorized, cv::NORM_INF));
+}
+
+TEST(ColormapTest, KernelReusesOutputTest)
+{
+    cv::Mat target(100, 100, CV_32F);
+    cv::randu(target, -1, 1);
+    target.at<float>(7, 7) = std::numeric_limits<float>::quiet_NaN();
+
+    cv::Mat colorized(100, 100, CV_8UC3);
+    const uchar* buffer = colorized.data;
+    ColormapKernel::colorize(target, -0.5, 0.5, identityLookupTable(), colorized);
+    EXPECT_EQ(buffer, colorized.data);
+    EXPECT_EQ(cv::Vec3b(0, 0, 0), colorized.at<cv::Vec3b>(7, 7));
+
+    ASSERT_THROW(ColormapKernel::colorize(cv::Mat(10, 10, CV_32FC2), 0, 1, identityLookupTable(), colorized), std::invalid_argument);
+}
+
+TEST(ColormapTest, KernelQuantizeTest)
+{
+    cv::Mat target(123, 77, CV_16S);
+    cv::randu(target, -1000, 1000);
+
+    //Colorizing the indices gives the colors of the values
+    const cv::Mat colors = ColormapKernel::lookupTable(cv::COLORMAP_JET);
+    cv::Mat expected;
+    ColormapKernel::colorize(target, -500, 700, colors, expected);
+    cv::Mat indices;
+    ColormapKernel::quantize(target, -500, 700, indices);
+    ASSERT_EQ(CV_8UC1, indices.type());
+    cv::Mat colorized;
+    ColormapKernel::colorize(indices, 0, 255, colors, colorized);
+    EXPECT_EQ(0, cv::norm(expected, colorized, cv::NORM_INF));
+}
+
+TEST(ColormapTest, KernelResampleTest)
+{
+    //A single feature that is smaller than a display pixel
+    cv::Mat indices(1000, 800, CV_8U, cv::Scalar(10));
+    indices.at<uchar>(503, 401) = 250;
+    indices.at<uchar>(11, 13) = 0;
+
+    cv::Mat resampled;
+    double minIndex{};
+    double maxIndex{};
+    ColormapKernel::resample(indices, cv::Size(80, 100), Downsampling::Max, resampled);
+    ASSERT_EQ(cv::Size(80, 100), resampled.size());
+    cv::minMaxLoc(resampled, &minIndex, &maxIndex);
+    EXPECT_EQ(10, minIndex);
+    EXPECT_EQ(250, maxIndex);
+
+    ColormapKernel::resample(indices, cv::Size(80, 100), Downsampling::Min, resampled);
+    cv::minMaxLoc(resampled, &minIndex, &maxIndex);
+    EXPECT_EQ(0, minIndex);
+    EXPECT_EQ(10, maxIndex);
+
+    //Average of the covered indices
+    ColormapKernel::resample(indices, cv::Size(80, 100), Downsampling::Area, resampled);
+    cv::minMaxLoc(resampled, &minIndex, &maxIndex);
+    EXPECT_GT(maxIndex, 10);
+    EXPECT_LT(maxIndex, 250);
+
+    //Enlarged indices keep the nearest index
+    ColormapKernel::resample(indices(cv::Rect(400, 500, 4, 4)), cv::Size(40, 40), Downsampling::Max, resampled);
+    EXPECT_EQ(250, resampled.at<uchar>(35, 15));
+    EXPECT_EQ(10, resampled.at<uchar>(25, 15));
+}
+
+TEST(ColormapTest, DownsampledCanvasTest)
+{
+    cv::Mat target(2000, 3000, CV_32F);
+    cv::randu(target, 0, 1);
+
+    Colormap colormap(target, 0.25, 0.75);
+    EXPECT_GT(colormap.requiredCanvasSize().width, target.cols);
+
+    //Downsampled colormaps fit into small panels
+    colormap.setDownsampling(Downsampling::Max);
+    colormap.setCanvasSize({640, 480});
+    EXPECT_EQ(cv::Size(640, 480), colormap.requiredCanvasSize());
+    const cv::Mat canvas = colormap.generate();
+    EXPECT_EQ(cv::Size(640, 480), canvas.size());
+}
+
+TEST(ColormapTest, UpdateMatchesNewColormapTest)
+{
+    //Frames span the whole colormap range, so a new colormap of a frame normalizes it the same way
+    cv::Mat first(60, 80, CV_32F);
+    cv::Mat second(60, 80, CV_32F);
+    cv::randu(first, 0, 10);
+    cv::randu(second, 0, 10);
+    first.at<float>(0, 0) = second.at<float>(0, 0) = 0;
+    first.at<float>(0, 1) = second.at<float>(0, 1) = 10;
+
+    Colormap colormap(first, 0.0, 10.0);
+    colormap.setText(TextField::Title, "Frame");
+    colormap.setCanvasSize({400, 300});
+    const cv::Mat canvas = colormap.generate();
+    const uint64_t revision = colormap.revision();
+
+    //The last canvas shows the new frame without another render
+    colormap.update(second);
+    EXPECT_GT(colormap.revision(), revision);
+    EXPECT_EQ(canvas.data, colormap.generate().data);
+
+    Colormap reference(second, 0.0, 10.0);
+    reference.setText(TextField::Title, "Frame");
+    reference.setCanvasSize({400, 300});
+    EXPECT_EQ(0, cv::norm(reference.generate(), canvas, cv::NORM_L1));
+}
+
+TEST(ColormapTest, UpdateNonSpanningFrameTest)
+{
+    //Neither frame spans the colormap range, both are normalized over their extremes like the range constructor does
+    cv::Mat first(60, 80, CV_32F);
+    cv::Mat second(60, 80, CV_32F);
+    cv::randu(first, 2, 8);
+    cv::randu(second, 4, 6);
+
+    Colormap colormap(first, 0.0, 10.0);
+    colormap.setCanvasSize({400, 300});
+    const cv::Mat original = colormap.generate().clone();
+
+    colormap.update(second);
+    Colormap reference(second, 0.0, 10.0);
+    reference.setCanvasSize({400, 300});
+    EXPECT_EQ(0, cv::norm(reference.generate(), colormap.generate(), cv::NORM_L1));
+
+    //Going back to the first frame reproduces the first canvas
+    colormap.update(first);
+    EXPECT_EQ(0, cv::norm(original, colormap.generate(), cv::NORM_L1));
+
+    //Like the range constructor, frames should have an element inside the colormap bounds
+    EXPECT_THROW(colormap.update(cv::Mat(60, 80, CV_32F, cv::Scalar(20))), std::runtime_error);
+}
+
+TEST(ColormapTest, UpdateDoesntAffectCopiesTest)
+{
+    cv::Mat first(60, 80, CV_32F);
+    cv::Mat second(60, 80, CV_32F);
+    cv::randu(first, 0, 10);
+    cv::randu(second, 0, 10);
+
+    Colormap colormap(first, 0.0, 10.0);
+    colormap.setCanvasSize({400, 300});
+    const cv::Mat reference = colormap.generate().clone();
+
+    //The copy shares the buffers of the colormap until one of them is updated
+    Colormap copy = colormap;
+    colormap.update(second);
+
+    cv::Mat rendered;
+    copy.generate(rendered);
+    EXPECT_EQ(0, cv::norm(reference, rendered, cv::NORM_L1));
+}
+
+TEST(ColormapTest, UpdateBeforeRenderTest)
+{
+    cv::Mat first(60, 80, CV_8U, cv::Scalar(0));
+    cv::Mat second(60, 80, CV_8U, cv::Scalar(0));
+    first.at<uchar>(0, 0) = 255;
+    second.at<uchar>(59, 79) = 255;
+
+    //Frames that arrive before a render are shown by the next one
+    Colormap colormap(first, cv::ColormapTypes::COLORMAP_JET);
+    const uint64_t revision = colormap.revision();
+    colormap.update(second);
+    EXPECT_GT(colormap.revision(), revision);
+    EXPECT_EQ(0, cv::norm(Colormap(second, cv::ColormapTypes::COLORMAP_JET).generate(), colormap.generate(), cv::NORM_L1));
+
+    //Frames should keep the size of the colormap
+    EXPECT_THROW(colormap.update(cv::Mat(80, 60, CV_8U)), std::invalid_argument);
+    EXPECT_THROW(colormap.update(cv::Mat(60, 80, CV_8UC3)), std::invalid_argument);
+}
+
+TEST(ColormapTest, WaterfallMatchesHistoryTest)
+{
+    //Eight rows are appended to a ring of four, so the ring wraps around twice. The history spans the whole colormap range
+    std::vector<cv::Mat> rows(8);
+    for(cv::Mat& row : rows){
+        row.create(1, 40, CV_32F);
+        cv::randu(row, 0, 10);
+    }
+    rows[5].at<float>(0, 0) = 0;
+    rows[6].at<float>(0, 0) = 10;
+
+    Colormap waterfall = Colormap::waterfall(40, 4, 0.0, 10.0);
+    EXPECT_TRUE(waterfall.isWaterfall());
+    for(const cv::Mat& row : rows){
+        waterfall.appendRow(row);
+    }
+
+    //The oldest row is displayed at the top
+    cv::Mat history;
+    cv::vconcat(std::vector<cv::Mat>(rows.begin() + 4, rows.end()), history);
+    Colormap reference(history, 0.0, 10.0);
+    EXPECT_EQ(0, cv::norm(reference.generate(), waterfall.generate(), cv::NORM_L1));
+
+    //Updating the waterfall replaces the whole history
+    waterfall.appendRow(rows[0]);
+    waterfall.update(history);
+    EXPECT_EQ(0, cv::norm(reference.generate(), waterfall.generate(), cv::NORM_L1));
+}
+
+TEST(ColormapTest, WaterfallAppendKeepsCanvasTest)
+{
+    Colormap waterfall = Colormap::waterfall(30, 20, -1.0, 1.0);
+    waterfall.setText(TextField::Title, "Spectrum");
+    waterfall.setCanvasSize({400, 300});
+    const cv::Mat canvas = waterfall.generate();
+    const uint64_t revision = waterfall.revision();
+
+    //Appended rows are composed into the last canvas, which matches a new render of the same history
+    cv::Mat row(1, 30, CV_64F);
+    for(int i = 0; i < 25; i++){
+        cv::randu(row, -1.0, 1.0);
+        waterfall.appendRow(row);
+    }
+    EXPECT_GT(waterfall.revision(), revision);
+    EXPECT_EQ(canvas.data, waterfall.generate().data);
+
+    cv::Mat rendered;
+    waterfall.generate(rendered);
+    EXPECT_NE(canvas.data, rendered.data);
+    EXPECT_EQ(0, cv::norm(rendered, canvas, cv::NORM_L1));
+}
+
+TEST(ColormapTest, WaterfallAppendDoesntAffectCopiesTest)
+{
+    //Both waterfalls get the same history, the twin shares no buffers with the others
+    Colormap waterfall = Colormap::waterfall(30, 20, -1.0, 1.0);
+    Colormap twin = Colormap::waterfall(30, 20, -1.0, 1.0);
+    cv::Mat row(1, 30, CV_64F);
+    for(int i = 0; i < 5; i++){
+        cv::randu(row, -1.0, 1.0);
+        waterfall.appendRow(row);
+        twin.appendRow(row);
+    }
+    const cv::Mat reference = waterfall.generate().clone();
+
+    //The copy shares the ring of the waterfall, appending to either of them doesn't change the rows of the other
+    Colormap copy = waterfall;
+    cv::randu(row, -1.0, 1.0);
+    waterfall.appendRow(row);
+    twin.appendRow(row);
+
+    cv::Mat rendered;
+    copy.generate(rendered);
+    EXPECT_EQ(0, cv::norm(reference, rendered, cv::NORM_L1));
+
+    cv::randu(row, -1.0, 1.0);
+    copy.appendRow(row);
+    EXPECT_EQ(0, cv::norm(twin.generate(), waterfall.generate(), cv::NORM_L1));
+}
+
+TEST(ColormapTest, WaterfallIllegalArgumentsTest)
+{
+    EXPECT_THROW(Colormap::waterfall(0, 10, 0.0, 1.0), std::invalid_argument);
+    EXPECT_THROW(Colormap::waterfall(10, 10, 1.0, 0.0), std::runtime_error);
+
+    Colormap waterfall = Colormap::waterfall(10, 5, 0.0, 1.0);
+    EXPECT_THROW(waterfall.appendRow(cv::Mat(1, 11, CV_32F)), std::invalid_argument);
+    EXPECT_THROW(waterfall.appendRow(cv::Mat(2, 10, CV_32F)), std::invalid_argument);
+    EXPECT_THROW(waterfall.setViewport(cv::Rect(0, 0, 5, 5)), std::runtime_error);
+
+    cv::Mat target(5, 10, CV_8U, cv::Scalar(1));
+    Colormap colormap(target, cv::ColormapTypes::COLORMAP_JET);
+    EXPECT_FALSE(colormap.isWaterfall());
+    EXPECT_THROW(colormap.appendRow(target.row(0)), std::runtime_error);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "gridlayout.h"
+#include "subplot.h"
+
+
+TEST(GridLayoutTest, ZeroDimensionTest)
+{
+    ASSERT_THROW(GridLayout(0, 3), std::invalid_argument);
+    ASSERT_THROW(GridLayout(3, 0), std::invalid_argument);
+}
+
+TEST(GridLayoutTest, MismatchedCellSizesTest)
+{
+    GridLayout layout(2, 2);
+    ASSERT_THROW(layout.arrange(std::vector<cv::Size>(3)), std::invalid_argument);
+}
+
+TEST(GridLayoutTest, LargestCellsTest)
+{
+    GridLayout layout(2, 3);
+    layout.arrange({{10, 5}, {20, 7}, {5, 1},
+                    {15, 9}, {3, 2}, {8, 4}});
+
+    EXPECT_EQ(7, layout.rowHeight(0));
+    EXPECT_EQ(9, layout.rowHeight(1));
+    EXPECT_EQ(15, layout.columnWidth(0));
+    EXPECT_EQ(20, layout.columnWidth(1));
+    EXPECT_EQ(8, layout.columnWidth(2));
+
+    EXPECT_EQ(cv::Rect(0, 0, 15, 7), layout.cellArea(0, 0));
+    EXPECT_EQ(cv::Rect(35, 7, 8, 9), layout.cellArea(1, 2));
+    EXPECT_EQ(layout.cellArea(1, 1), layout.cellArea(4));
+    EXPECT_EQ(cv::Size(43, 16), layout.size());
+}
+
+TEST(GridLayoutTest, FixedCellSizeTest)
+{
+    GridLayout layout(3, 4);
+    layout.arrange(cv::Size{32, 24});
+
+    EXPECT_EQ(cv::Rect(96, 48, 32, 24), layout.cellArea(2, 3));
+    EXPECT_EQ(cv::Size(128, 72), layout.size());
+}
+
+TEST(GridLayoutTest, LargeGridTest)
+{
+    constexpr size_t GRID_DIMENSION = 128;
+    std::vector<cv::Size> cellSizes(GRID_DIMENSION * GRID_DIMENSION, cv::Size{64, 48});
+    cellSizes.back() = cv::Size{70, 50};
+
+    GridLayout layout(GRID_DIMENSION, GRID_DIMENSION);
+    layout.arrange(cellSizes);
+
+    EXPECT_EQ(cv::Rect(64 * (GRID_DIMENSION - 1), 48 * (GRID_DIMENSION - 1), 70, 50), layout.cellArea(cellSizes.size() - 1));
+    EXPECT_EQ(cv::Size(64 * (GRID_DIMENSION - 1) + 70, 48 * (GRID_DIMENSION - 1) + 50), layout.size());
+}
+
+TEST(GridLayoutTest, SubplotFixedCellSizeTest)
+{
+    auto space = std::make_shared<Plottable>(EmptySpace());
+    Subplot subplot(std::vector<std::shared_ptr<Plottable>>(64 * 64, space), 64, 64);
+    subplot.setCanvasSize({0, 0});
+    subplot.setCellSize(cv::Size{8, 6});
+
+    EXPECT_EQ(cv::Size(64 * 8 + 20, 64 * 6 + 20), subplot.requiredCanvasSize());
+    EXPECT_EQ(subplot.requiredCanvasSize(), subplot.generate().size());
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include "histogram.h"
+#include "histogrambinning.h"
+#include <limits>
+#include <numeric>
 
 
 class GaussianMat : public testing::Test
@@ -97,3 +100,312 @@ TEST_F(GaussianMat, InvalidBoundsTest)
 
 
 
+
+TEST(HistogramTest, MatrixConstructorExactCountsTest)
+{
+    //The number of values cannot be represented by a float counter
+    const cv::Mat data(4097, 4097, CV_16U, cv::Scalar(1000));
+    Histogram hist(data);
+    const std::vector<size_t>& counts = hist.getHistogram();
+    EXPECT_EQ(data.total(), std::accumulate(counts.begin(), counts.end(), size_t{0}));
+}
+
+TEST(HistogramTest, MatrixConstructorRejectedValuesTest)
+{
+    cv::Mat data(100, 100, CV_32F, cv::Scalar(5.0F));
+    data.row(0).setTo(std::numeric_limits<float>::quiet_NaN());
+    data.row(1).setTo(50.0F);
+
+    Histogram hist(data, 10, 0.0F, 10.0F);
+    EXPECT_EQ(100, hist.getNanCount());
+    EXPECT_EQ(100, hist.getOutOfRangeCount());
+    EXPECT_EQ(9800, hist.getHistogram()[5]);
+}
+
+namespace {
+    cv::Mat randomFrame(const int seed)
+    {
+        cv::RNG rng(seed);
+        cv::Mat frame(120, 160, CV_32F);
+        rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar(-10), cv::Scalar(110));
+        return frame;
+    }
+
+    std::vector<size_t> frameCounts(const std::vector<cv::Mat>& frames)
+    {
+        std::vector<size_t> counts(20, 0);
+        for(const cv::Mat& frame : frames){
+            HistogramBinning::accumulateCounts(frame, 0.0F, 100.0F, counts);
+        }
+        return counts;
+    }
+}
+
+TEST(HistogramTest, AccumulateTest)
+{
+    Histogram hist(std::vector<size_t>(20, 0), 0.0F, 100.0F);
+    std::vector<cv::Mat> frames;
+    for(int i = 0; i < 3; i++){
+        frames.push_back(randomFrame(i));
+        hist.accumulate(frames.back());
+    }
+    EXPECT_EQ(frameCounts(frames), hist.getHistogram());
+
+    hist.subtract(frames[1]);
+    EXPECT_EQ(frameCounts({frames[0], frames[2]}), hist.getHistogram());
+    ASSERT_THROW(hist.subtract(frames[1]), std::invalid_argument);
+    EXPECT_EQ(frameCounts({frames[0], frames[2]}), hist.getHistogram());
+}
+
+TEST(HistogramTest, AccumulateSingleBinTest)
+{
+    //The only bin spans the whole range
+    Histogram hist(std::vector<size_t>{0}, 0.0F, 100.0F);
+    const cv::Mat frame = randomFrame(0);
+    hist.accumulate(frame);
+
+    std::vector<size_t> counts(1, 0);
+    HistogramBinning::RejectedValues rejected;
+    HistogramBinning::accumulateCounts(frame, 0.0F, 100.0F, counts, 0, &rejected);
+    EXPECT_GT(counts[0], 0U);
+    EXPECT_EQ(counts, hist.getHistogram());
+    EXPECT_EQ(rejected.outOfRange, hist.getOutOfRangeCount());
+}
+
+TEST(HistogramTest, AccumulateExplicitBinsTest)
+{
+    //Explicitly given bins aren't assumed to be uniform
+    Histogram hist(std::vector<size_t>{0, 0, 0}, std::vector<float>{0.0F, 1.0F, 10.0F});
+    ASSERT_THROW(hist.accumulate(randomFrame(0)), std::runtime_error);
+    ASSERT_THROW(hist.subtract(randomFrame(0)), std::runtime_error);
+    EXPECT_EQ(std::vector<size_t>(3, 0), hist.getHistogram());
+}
+
+TEST(HistogramTest, AccumulateRenderTest)
+{
+    Histogram hist(std::vector<size_t>(20, 0), 0.0F, 100.0F);
+    const cv::Mat emptyCanvas = hist.generate().clone();
+
+    hist.accumulate(randomFrame(0));
+    const cv::Mat canvas = hist.generate();
+    EXPECT_GT(cv::norm(emptyCanvas, canvas, cv::NORM_L1), 0);
+}
+
+TEST(HistogramTest, SlidingWindowTest)
+{
+    Histogram hist(std::vector<size_t>(20, 0), 0.0F, 100.0F);
+    hist.setSlidingWindow(2);
+
+    std::vector<cv::Mat> frames;
+    for(int i = 0; i < 5; i++){
+        frames.push_back(randomFrame(i));
+        hist.accumulate(frames.back());
+        EXPECT_EQ(frameCounts({frames.end() - std::min<size_t>(frames.size(), 2), frames.end()}), hist.getHistogram());
+    }
+    ASSERT_THROW(hist.subtract(frames.back()), std::runtime_error);
+
+    hist.setSlidingWindow(1);
+    EXPECT_EQ(frameCounts({frames.back()}), hist.getHistogram());
+}
+
+TEST(HistogramTest, DecayTest)
+{
+    Histogram hist(std::vector<size_t>(20, 0), 0.0F, 100.0F);
+    hist.setDecayFactor(0.5);
+
+    const cv::Mat frame = randomFrame(0);
+    hist.accumulate(frame);
+    hist.accumulate(frame);
+
+    //Two frames with the weights 0.5 and 1
+    const std::vector<size_t> counts = frameCounts({frame});
+    for(size_t i = 0; i < counts.size(); i++){
+        EXPECT_EQ(static_cast<size_t>(std::llround(counts[i] * 1.5)), hist.getHistogram()[i]);
+    }
+
+    ASSERT_THROW(hist.setDecayFactor(1.5), std::invalid_argument);
+    ASSERT_THROW(hist.setSlidingWindow(3), std::invalid_argument);
+
+    hist.resetCounts();
+    EXPECT_EQ(std::vector<size_t>(20, 0), hist.getHistogram());
+    EXPECT_EQ(0, hist.getOutOfRangeCount());
+}
+
+TEST(HistogramTest, SampledHistogramTest)
+{
+    cv::Mat data(1000, 1000, CV_32F);
+    cv::randu(data, 0, 100);
+    const cv::Mat roi = data(cv::Rect(10, 10, 900, 900));
+    const Histogram exact(roi, 20, 0.0F, 100.0F);
+
+    using Method = HistogramBinning::SamplingMethod;
+    for(const Method method : {Method::Strided, Method::Random, Method::Block}){
+        Histogram approximate(roi, 20, 0.0F, 100.0F, HistogramBinning::Sampling{method, 50000, 7});
+        ASSERT_TRUE(approximate.isApproximate());
+        ASSERT_EQ(exact.getBins(), approximate.getBins());
+
+        const std::vector<std::pair<size_t, size_t>>& intervals = approximate.getConfidenceIntervals();
+        ASSERT_EQ(exact.getHistogram().size(), intervals.size());
+        for(size_t i = 0; i < intervals.size(); i++){
+            EXPECT_LE(intervals[i].first, approximate.getHistogram()[i]);
+            EXPECT_GE(intervals[i].second, approximate.getHistogram()[i]);
+            EXPECT_NEAR(exact.getHistogram()[i], approximate.getHistogram()[i], exact.getHistogram()[i] * 0.1);
+        }
+
+        ASSERT_THROW(approximate.refine(data), std::invalid_argument);
+        approximate.refine(roi);
+        EXPECT_FALSE(approximate.isApproximate());
+        EXPECT_TRUE(approximate.getConfidenceIntervals().empty());
+        EXPECT_EQ(exact.getHistogram(), approximate.getHistogram());
+    }
+}
+
+TEST(HistogramTest, SampledHistogramDoesntKeepArrayTest)
+{
+    cv::Mat frame(1000, 1000, CV_32F);
+    cv::randu(frame, 0, 100);
+    Histogram approximate(frame, 20, 0.0F, 100.0F, HistogramBinning::Sampling{HistogramBinning::SamplingMethod::Strided, 50000, 7});
+
+    //The buffer is reused by the next capture, refining counts the array that is given
+    cv::randu(frame, 0, 50);
+    approximate.refine(frame);
+    EXPECT_EQ(Histogram(frame, 20, 0.0F, 100.0F).getHistogram(), approximate.getHistogram());
+}
+
+TEST(HistogramTest, SampledSmallArrayTest)
+{
+    //Arrays that don't have more pixels than the samples are counted exactly
+    cv::Mat data(100, 100, CV_16U);
+    cv::randu(data, 0, 1000);
+
+    HistogramBinning::Sampling sampling;
+    sampling.sampleCount = data.total();
+    const Histogram histogram(data, {}, {}, {}, sampling);
+    EXPECT_FALSE(histogram.isApproximate());
+    EXPECT_EQ(Histogram(data).getHistogram(), histogram.getHistogram());
+
+    sampling.sampleCount = 0;
+    ASSERT_THROW(Histogram(data, {}, {}, {}, sampling), std::invalid_argument);
+}
+
+namespace {
+    int countPixelsOfColor(const cv::Mat& canvas, const cv::Scalar& color)
+    {
+        cv::Mat matches;
+        cv::inRange(canvas, color, color, matches);
+        return cv::countNonZero(matches);
+    }
+}
+
+TEST(HistogramTest, AggregatedBinsCanvasWidthTest)
+{
+    //One bin per 16-bit value
+    Histogram empty(std::vector<size_t>(65536, 0), 0.0F, 65536.0F);
+    std::vector<size_t> counts(65536, 0);
+    counts[30000] = 100;
+    Histogram histogram(counts, 0.0F, 65536.0F);
+    EXPECT_GT(histogram.requiredCanvasSize().width, 65536);
+
+    for(const BinAggregation aggregation : {BinAggregation::Max, BinAggregation::Sum, BinAggregation::MinMaxEnvelope}){
+        empty.setBinAggregation(aggregation);
+        histogram.setBinAggregation(aggregation);
+        const cv::Mat canvas = histogram.generate();
+        EXPECT_LT(canvas.cols, 1000);
+
+        //The single non-empty bin is still visible as a bar
+        EXPECT_GT(countPixelsOfColor(canvas, PainterConstants::black), countPixelsOfColor(empty.generate(), PainterConstants::black));
+    }
+}
+
+TEST(HistogramTest, AggregatedEnvelopeTest)
+{
+    //Every pixel column holds empty and full bins, only the envelope shows the difference
+    std::vector<size_t> counts(1000, 0);
+    for(size_t i = 0; i < counts.size(); i += 2){
+        counts[i] = 10;
+    }
+    Histogram histogram(counts, 0.0F, 1000.0F);
+
+    histogram.setBinAggregation(BinAggregation::MinMaxEnvelope);
+    const int envelopePixels = countPixelsOfColor(histogram.generate(), PainterConstants::gray);
+
+    histogram.setBinAggregation(BinAggregation::Max);
+    EXPECT_GT(envelopePixels, countPixelsOfColor(histogram.generate(), PainterConstants::gray) + 1000);
+}
+
+TEST(HistogramTest, PerChannelTest)
+{
+    cv::Mat data(300, 400, CV_8UC3);
+    cv::randu(data, cv::Scalar(0, 50, 100), cv::Scalar(150, 200, 256));
+    std::vector<cv::Mat> channels;
+    cv::split(data, channels);
+
+    const Histogram histogram = Histogram::perChannel(data, 16, 0.0F, 256.0F);
+    ASSERT_EQ(channels.size(), histogram.getSeriesCount());
+    for(size_t i = 0; i < channels.size(); i++){
+        EXPECT_EQ(Histogram(channels[i], 16, 0.0F, 256.0F).getHistogram(), histogram.getHistogram(i));
+    }
+    EXPECT_EQ(histogram.getHistogram(0), histogram.getHistogram());
+    ASSERT_THROW(histogram.getHistogram(3), std::out_of_range);
+
+    //The range covers every channel if it isn't given
+    const Histogram autoRange = Histogram::perChannel(data, 10);
+    EXPECT_LE(autoRange.getBins().front(), 0.0F);
+    EXPECT_GE(autoRange.getBins().back(), 255.0F);
+}
+
+TEST(HistogramTest, PerChannelResetTest)
+{
+    cv::Mat data(100, 100, CV_32FC3);
+    cv::randu(data, -10, 110);
+    Histogram histogram = Histogram::perChannel(data, 16, 0.0F, 100.0F);
+    ASSERT_GT(histogram.getOutOfRangeCount(), 0U);
+
+    //Every series is reset together with the rejected tallies
+    histogram.resetCounts();
+    for(size_t i = 0; i < histogram.getSeriesCount(); i++){
+        EXPECT_EQ(std::vector<size_t>(16, 0), histogram.getHistogram(i));
+    }
+    EXPECT_EQ(0U, histogram.getOutOfRangeCount());
+}
+
+TEST(HistogramTest, PerChannelRenderTest)
+{
+    cv::Mat data(100, 100, CV_8UC3);
+    cv::randu(data, 0, 256);
+    Histogram histogram = Histogram::perChannel(data, 50, 0.0F, 256.0F);
+
+    //Every channel is drawn with its own color in both layouts
+    for(const SeriesLayout layout : {SeriesLayout::Overlaid, SeriesLayout::SideBySide}){
+        histogram.setSeriesLayout(layout);
+        const cv::Mat canvas = histogram.generate();
+        for(const cv::Scalar& color : {PainterConstants::blue, PainterConstants::green, PainterConstants::red}){
+            EXPECT_GT(countPixelsOfColor(canvas, color), 0);
+        }
+    }
+    EXPECT_GE(histogram.requiredCanvasSize().width, 150);
+
+    ASSERT_THROW(histogram.accumulate(data), std::runtime_error);
+}
+
+TEST(HistogramTest, FromSelectionTest)
+{
+    cv::Mat data(200, 200, CV_32F);
+    cv::randu(data, 0, 100);
+    cv::Mat mask(200, 200, CV_8U, cv::Scalar(0));
+    cv::inRange(data, 20, 30, mask);
+
+    HistogramBinning::PixelSelection selection;
+    selection.mask = mask;
+    const Histogram histogram = Histogram::fromSelection(data, selection, 10);
+    EXPECT_GE(histogram.getBins().front(), 18.0F);
+    EXPECT_LE(histogram.getBins().back(), 32.0F);
+    EXPECT_EQ(static_cast<size_t>(cv::countNonZero(mask)), std::accumulate(histogram.getCounts().begin(), histogram.getCounts().end(), size_t{0}));
+
+    //Every selected pixel weighs two
+    selection.weights = cv::Mat(200, 200, CV_32F, cv::Scalar(2));
+    const Histogram weighted = Histogram::fromSelection(data, selection, 10, histogram.getBins().front(), histogram.getBins().back());
+    for(size_t i = 0; i < histogram.getHistogram().size(); i++){
+        EXPECT_EQ(2 * histogram.getHistogram()[i], weighted.getHistogram()[i]);
+    }
+}
@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+#include "histogrambinning.h"
+#include "opencv2/imgproc.hpp"
+#include <limits>
+#include <numeric>
+
+
+namespace {
+    //Reference counts of the previous implementation
+    std::vector<size_t> calcHistCounts(const cv::Mat& input, const int binCount, const float binStart, const float binEnd, const cv::Mat& mask = cv::Mat())
+    {
+        cv::Mat hist;
+        const std::vector<float> ranges{binStart, binEnd};
+        cv::calcHist(std::vector<cv::Mat>{input}, {0}, mask, hist, {binCount}, ranges, true);
+        return std::vector<size_t>(hist.begin<float>(), hist.end<float>());
+    }
+}
+
+class BinningInput : public testing::TestWithParam<int>
+{
+public:
+    void SetUp() override{
+        data = cv::Mat(1000, 700, GetParam());
+        cv::randu(data, 0, 4000);
+    };
+    cv::Mat getMat() const {return data;};
+
+private:
+    cv::Mat data;
+};
+
+TEST_P(BinningInput, MatchesCalcHistTest)
+{
+    for(const int parallelism : {1, 2, 7, 0}){
+        EXPECT_EQ(calcHistCounts(getMat(), 97, 13.5F, 3900.25F), HistogramBinning::countBins(getMat(), 97, 13.5F, 3900.25F, parallelism));
+    }
+}
+
+TEST_P(BinningInput, MinMaxMatchesMinMaxLocTest)
+{
+    double minVal{};
+    double maxVal{};
+    cv::minMaxLoc(getMat(), &minVal, &maxVal);
+
+    for(const int parallelism : {1, 3, 0}){
+        EXPECT_EQ(std::make_pair(minVal, maxVal), HistogramBinning::minMax(getMat(), parallelism));
+    }
+}
+
+TEST_P(BinningInput, NonContinuousArrayTest)
+{
+    const cv::Mat roi = getMat()(cv::Rect(13, 17, 600, 900));
+    ASSERT_FALSE(roi.isContinuous());
+    EXPECT_EQ(calcHistCounts(roi, 50, 0, 4000), HistogramBinning::countBins(roi, 50, 0, 4000, 4));
+}
+
+TEST_P(BinningInput, ValueCountsMatchCountBinsTest)
+{
+    if(!HistogramBinning::supportsValueCounts(getMat()))
+        GTEST_SKIP();
+
+    const std::vector<size_t> valueCounts = HistogramBinning::valueCounts(getMat(), 3);
+    EXPECT_EQ(getMat().total(), std::accumulate(valueCounts.begin(), valueCounts.end(), size_t{0}));
+    EXPECT_EQ(HistogramBinning::minMax(getMat()), HistogramBinning::minMax(valueCounts));
+    EXPECT_EQ(HistogramBinning::countBins(getMat(), 97, 13.5F, 3900.25F), HistogramBinning::foldValueCounts(valueCounts, 97, 13.5F, 3900.25F));
+    EXPECT_EQ(HistogramBinning::countBins(getMat(), 7, -0.5F, 300.0F), HistogramBinning::foldValueCounts(valueCounts, 7, -0.5F, 300.0F));
+}
+
+INSTANTIATE_TEST_SUITE_P(HistogramBinningTest, BinningInput, testing::Values(CV_8U, CV_16U, CV_32F));
+
+TEST(HistogramBinningTest, AccumulateCountsTest)
+{
+    cv::Mat first(300, 300, CV_16U);
+    cv::Mat second(200, 100, CV_16U);
+    cv::randu(first, 0, 1000);
+    cv::randu(second, 0, 1000);
+
+    std::vector<size_t> counts = HistogramBinning::countBins(first, 20, 0, 1000);
+    HistogramBinning::accumulateCounts(second, 0, 1000, counts);
+
+    const std::vector<size_t> firstCounts = calcHistCounts(first, 20, 0, 1000);
+    const std::vector<size_t> secondCounts = calcHistCounts(second, 20, 0, 1000);
+    for(size_t i = 0; i < counts.size(); i++){
+        EXPECT_EQ(firstCounts[i] + secondCounts[i], counts[i]);
+    }
+}
+
+TEST(HistogramBinningTest, CountsAboveFloatPrecisionTest)
+{
+    //Float counters cannot represent this count, table counters must keep it exact
+    const cv::Mat data(4097, 4097, CV_8U, cv::Scalar(7));
+    const std::vector<size_t> valueCounts = HistogramBinning::valueCounts(data);
+    EXPECT_EQ(size_t{4097} * 4097, valueCounts[7]);
+    EXPECT_EQ(std::make_pair(7.0, 7.0), HistogramBinning::minMax(valueCounts));
+}
+
+TEST(HistogramBinningTest, IllegalArgumentsTest)
+{
+    const cv::Mat data(10, 10, CV_8U, cv::Scalar(1));
+    ASSERT_THROW(HistogramBinning::countBins(cv::Mat(), 10, 0, 1), std::invalid_argument);
+    ASSERT_THROW(HistogramBinning::countBins(data, 0, 0, 1), std::invalid_argument);
+    ASSERT_THROW(HistogramBinning::minMax(data, -1), std::invalid_argument);
+    ASSERT_THROW(HistogramBinning::valueCounts(cv::Mat(10, 10, CV_32F)), std::invalid_argument);
+}
+
+TEST(HistogramBinningTest, DoubleMatchesFloatTest)
+{
+    cv::Mat floatData(333, 517, CV_32F);
+    cv::randu(floatData, -100, 100);
+    cv::Mat doubleData;
+    floatData.convertTo(doubleData, CV_64F);
+
+    //Every float is exactly representable as a double and both depths are mapped in double precision
+    for(const int parallelism : {1, 0}){
+        EXPECT_EQ(HistogramBinning::countBins(floatData, 61, -90.5F, 80.0F, parallelism), HistogramBinning::countBins(doubleData, 61, -90.5F, 80.0F, parallelism));
+    }
+}
+
+TEST(HistogramBinningTest, RejectedValuesTest)
+{
+    //Odd length, so that some values are left over after the vector lanes
+    const std::vector<float> values{0.5F, std::numeric_limits<float>::quiet_NaN(), 9.99F, 10.0F, -0.01F, std::numeric_limits<float>::infinity(),
+                                    -std::numeric_limits<float>::infinity(), 3.0F, std::numeric_limits<float>::quiet_NaN(), 1e30F, 7.25F, 0.0F, -1e30F};
+    for(const int depth : {CV_32F, CV_64F}){
+        cv::Mat data;
+        cv::Mat(values, true).reshape(1, 1).convertTo(data, depth);
+
+        HistogramBinning::RejectedValues rejected;
+        const std::vector<size_t> counts = HistogramBinning::countBins(data, 10, 0.0F, 10.0F, 1, &rejected);
+
+        EXPECT_EQ((std::vector<size_t>{2, 0, 0, 1, 0, 0, 0, 1, 0, 1}), counts);
+        EXPECT_EQ(2, rejected.nan);
+        EXPECT_EQ(6, rejected.outOfRange);
+    }
+}
+
+TEST(HistogramBinningTest, RejectedValuesOfStripesTest)
+{
+    cv::Mat data(1000, 1000, CV_32F);
+    cv::randu(data, 0, 100);
+    data.rowRange(0, 10).setTo(std::numeric_limits<float>::quiet_NaN());
+    data.rowRange(990, 1000).setTo(-5.0F);
+
+    for(const int parallelism : {1, 4}){
+        HistogramBinning::RejectedValues rejected;
+        const std::vector<size_t> counts = HistogramBinning::countBins(data, 100, 0.0F, 100.0F, parallelism, &rejected);
+        EXPECT_EQ(10000, rejected.nan);
+        EXPECT_EQ(10000, rejected.outOfRange);
+        EXPECT_EQ(data.total() - 20000, std::accumulate(counts.begin(), counts.end(), size_t{0}));
+    }
+}
+
+TEST(HistogramBinningTest, RejectedValueCountsTest)
+{
+    cv::Mat data(100, 100, CV_8U);
+    cv::randu(data, 0, 256);
+
+    HistogramBinning::RejectedValues expected;
+    HistogramBinning::RejectedValues folded;
+    const std::vector<size_t> counts = HistogramBinning::countBins(data, 16, 50.0F, 200.0F, 1, &expected);
+    EXPECT_EQ(counts, HistogramBinning::foldValueCounts(HistogramBinning::valueCounts(data), 16, 50.0F, 200.0F, &folded));
+    EXPECT_EQ(expected.outOfRange, folded.outOfRange);
+    EXPECT_EQ(0, folded.nan);
+}
+
+TEST(HistogramBinningTest, SampleTest)
+{
+    cv::Mat data(200, 300, CV_32S);
+    std::iota(data.begin<int>(), data.end<int>(), 0);
+    const cv::Mat roi = data(cv::Rect(50, 20, 100, 100));
+
+    using Method = HistogramBinning::SamplingMethod;
+    const cv::Mat strided = HistogramBinning::sample(roi, {Method::Strided, 100, 0});
+    ASSERT_EQ(cv::Size(100, 1), strided.size());
+    for(int i = 0; i < strided.cols; i++){
+        EXPECT_EQ(roi.at<int>(i, 0), strided.at<int>(i));
+    }
+
+    //Every block is a run of adjacent pixels of a row of the region
+    const cv::Mat blocks = HistogramBinning::sample(roi, {Method::Block, 1000, 3});
+    for(int i = 0; i < blocks.cols; i += 64){
+        const int value = blocks.at<int>(i);
+        EXPECT_TRUE(value % 300 >= 50 && value % 300 < 150 && value / 300 >= 20 && value / 300 < 120);
+        for(int k = 1; k < 64 && i + k < blocks.cols; k++){
+            EXPECT_EQ(value + k, blocks.at<int>(i + k));
+        }
+    }
+
+    const cv::Mat random = HistogramBinning::sample(roi, {Method::Random, 5000, 11});
+    EXPECT_EQ(5000, random.total());
+    EXPECT_EQ(roi.data, HistogramBinning::sample(roi, {Method::Random, roi.total(), 11}).data);
+}
+
+TEST(HistogramBinningTest, CountChannelsTest)
+{
+    for(const int type : {CV_8UC3, CV_16UC4, CV_32FC3}){
+        cv::Mat data(400, 301, type);
+        cv::randu(data, 0, 1000);
+        const cv::Mat roi = data(cv::Rect(7, 11, 250, 300));
+        std::vector<cv::Mat> channels;
+        cv::split(roi, channels);
+
+        for(const int parallelism : {1, 3, 0}){
+            const std::vector<std::vector<size_t>> counts = HistogramBinning::countChannels(roi, 37, 10.0F, 900.0F, parallelism);
+            ASSERT_EQ(channels.size(), counts.size());
+            for(size_t i = 0; i < channels.size(); i++){
+                EXPECT_EQ(calcHistCounts(channels[i], 37, 10.0F, 900.0F), counts[i]);
+            }
+        }
+    }
+}
+
+TEST_P(BinningInput, SelectionMatchesCalcHistTest)
+{
+    //The mask is a view of a larger array, so it isn't continuous while the input is
+    cv::Mat maskData(1100, 800, CV_8U);
+    cv::randu(maskData, 0, 2);
+    HistogramBinning::PixelSelection selection;
+    selection.mask = maskData(cv::Rect(50, 50, getMat().cols, getMat().rows));
+    ASSERT_FALSE(selection.mask.isContinuous());
+
+    for(const int parallelism : {1, 3, 0}){
+        EXPECT_EQ(calcHistCounts(getMat(), 97, 13.5F, 3900.25F, selection.mask), HistogramBinning::countBins(getMat(), selection, 97, 13.5F, 3900.25F, parallelism));
+    }
+
+    //Overlapping pixels are counted once per region
+    selection.regions = {cv::Rect(0, 0, 300, 200), cv::Rect(100, 150, 600, 850), cv::Rect(0, 0, 0, 0)};
+    std::vector<size_t> expected(50, 0);
+    for(const cv::Rect& region : {selection.regions[0], selection.regions[1]}){
+        const std::vector<size_t> regionCounts = calcHistCounts(getMat()(region), 50, 0, 4000, selection.mask(region));
+        std::transform(expected.begin(), expected.end(), regionCounts.begin(), expected.begin(), std::plus<size_t>());
+    }
+    EXPECT_EQ(expected, HistogramBinning::countBins(getMat(), selection, 50, 0, 4000, 4));
+}
+
+TEST(HistogramBinningTest, WeightedBinsTest)
+{
+    cv::Mat data(300, 200, CV_8U);
+    cv::randu(data, 0, 256);
+    cv::Mat weights(300, 200, CV_32F);
+    cv::randu(weights, 0, 2);
+
+    HistogramBinning::PixelSelection selection;
+    selection.weights = weights;
+    selection.regions = {cv::Rect(10, 20, 150, 250)};
+
+    std::vector<double> expected(16, 0.0);
+    for(int r = 20; r < 270; r++){
+        for(int c = 10; c < 160; c++){
+            expected[data.at<uchar>(r, c) / 16] += weights.at<float>(r, c);
+        }
+    }
+
+    for(const int parallelism : {1, 0}){
+        const std::vector<double> weightedCounts = HistogramBinning::countWeightedBins(data, selection, 16, 0.0F, 256.0F, parallelism);
+        ASSERT_EQ(expected.size(), weightedCounts.size());
+        for(size_t i = 0; i < expected.size(); i++){
+            EXPECT_NEAR(expected[i], weightedCounts[i], 1e-6 * expected[i]);
+        }
+    }
+}
+
+TEST(HistogramBinningTest, SelectionIllegalArgumentsTest)
+{
+    const cv::Mat data(10, 10, CV_32F, cv::Scalar(1));
+    HistogramBinning::PixelSelection selection;
+    selection.mask = cv::Mat(10, 11, CV_8U, cv::Scalar(1));
+    ASSERT_THROW(HistogramBinning::countBins(data, selection, 10, 0, 1), std::invalid_argument);
+
+    selection.mask = cv::Mat();
+    selection.regions = {cv::Rect(5, 5, 6, 2)};
+    ASSERT_THROW(HistogramBinning::countBins(data, selection, 10, 0, 1), std::invalid_argument);
+
+    selection.regions.clear();
+    selection.weights = cv::Mat(10, 10, CV_32F, cv::Scalar(1));
+    ASSERT_THROW(HistogramBinning::countBins(data, selection, 10, 0, 1), std::invalid_argument);
+    ASSERT_THROW(HistogramBinning::countWeightedBins(data, HistogramBinning::PixelSelection(), 10, 0, 1), std::invalid_argument);
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "histogramstorage.h"
+#include "histogram.h"
+#include "PlotUtils.h"
+#include <limits>
+
+
+TEST(HistogramStorageTest, NarrowCountsTest)
+{
+    HistogramCounts counts(std::vector<size_t>{1, 2, 3}, CountWidth::Bits32);
+    EXPECT_EQ(CountWidth::Bits32, counts.width());
+    EXPECT_EQ(3 * sizeof(uint32_t), counts.bytes());
+    EXPECT_EQ((std::vector<size_t>{1, 2, 3}), counts);
+
+    counts.add({10, 20, 30});
+    EXPECT_EQ((std::vector<size_t>{11, 22, 33}), counts);
+    counts.subtract({1, 2, 3});
+    EXPECT_EQ((std::vector<size_t>{10, 20, 30}), counts);
+    ASSERT_THROW(counts.add({1, 2}), std::invalid_argument);
+}
+
+TEST(HistogramStorageTest, WideningCountsTest)
+{
+    //Counts that outgrow 32 bits widen the storage instead of wrapping around
+    constexpr size_t LARGEST_NARROW_COUNT = std::numeric_limits<uint32_t>::max();
+    HistogramCounts counts(std::vector<size_t>{LARGEST_NARROW_COUNT, 0}, CountWidth::Bits32);
+    EXPECT_EQ(CountWidth::Bits32, counts.width());
+
+    counts.add({1, 1});
+    EXPECT_EQ(CountWidth::Bits64, counts.width());
+    EXPECT_EQ(LARGEST_NARROW_COUNT + 1, counts[0]);
+
+    counts.setWidth(CountWidth::Bits32);
+    EXPECT_EQ(CountWidth::Bits64, counts.width());
+
+    counts.set(0, 5);
+    counts.setWidth(CountWidth::Bits32);
+    EXPECT_EQ(CountWidth::Bits32, counts.width());
+    EXPECT_EQ((std::vector<size_t>{5, 1}), counts);
+}
+
+TEST(HistogramStorageTest, UniformBinsTest)
+{
+    const BinsView bins(-3.5F, 101.25F, 77);
+    const std::vector<float> materialized = PlotUtils::linspace(-3.5F, 101.25F, 77);
+
+    ASSERT_TRUE(bins.isUniform());
+    ASSERT_EQ(materialized.size(), bins.size());
+    EXPECT_EQ(materialized.front(), bins.front());
+    EXPECT_EQ(materialized.back(), bins.back());
+    for(size_t i = 0; i < bins.size(); i++){
+        EXPECT_FLOAT_EQ(materialized[i], bins[i]);
+    }
+    EXPECT_EQ(bins.toVector(), bins);
+}
+
+TEST(HistogramStorageTest, HistogramStorageTest)
+{
+    cv::Mat data(100, 100, CV_16U);
+    cv::randu(data, 0, 1000);
+
+    Histogram histogram(data, 50);
+    const std::vector<size_t> counts = histogram.getHistogram();
+    EXPECT_TRUE(histogram.getBinsView().isUniform());
+
+    histogram.setCountWidth(CountWidth::Bits32);
+    EXPECT_EQ(CountWidth::Bits32, histogram.getCountWidth());
+    EXPECT_EQ(counts, histogram.getHistogram());
+
+    //Clones keep the compact representation
+    const Histogram clone = histogram.clone();
+    EXPECT_EQ(CountWidth::Bits32, clone.getCountWidth());
+    EXPECT_TRUE(clone.getBinsView().isUniform());
+    EXPECT_EQ(histogram.getBinsView(), clone.getBinsView());
+}
+
+TEST(HistogramStorageTest, BinsMatchLinspaceTest)
+{
+    //Copied bins are identical to the bins that the histogram used to store
+    const Histogram histogram(std::vector<size_t>(1000, 1), -0.1F, 0.7F);
+    EXPECT_EQ(PlotUtils::linspace(-0.1F, 0.7F, 1000), histogram.getBins());
+
+    const std::vector<size_t> counts = histogram.getHistogram();
+    EXPECT_EQ(counts, histogram.getCounts());
+}
+
+TEST(HistogramStorageTest, RequestedWidthTest)
+{
+    //Counts that have outgrown the requested width return to it once they are reset
+    constexpr size_t LARGEST_NARROW_COUNT = std::numeric_limits<uint32_t>::max();
+    Histogram histogram(std::vector<size_t>{LARGEST_NARROW_COUNT, 0}, 0.0F, 2.0F);
+    histogram.setCountWidth(CountWidth::Bits32);
+    EXPECT_EQ(CountWidth::Bits32, histogram.getRequestedCountWidth());
+
+    histogram.accumulate(cv::Mat(1, 1, CV_32F, cv::Scalar(0.5)));
+    EXPECT_EQ(CountWidth::Bits64, histogram.getCountWidth());
+    EXPECT_EQ(LARGEST_NARROW_COUNT + 1, histogram.getHistogram()[0]);
+
+    histogram.resetCounts();
+    EXPECT_EQ(CountWidth::Bits32, histogram.getCountWidth());
+    EXPECT_EQ(CountWidth::Bits32, histogram.getRequestedCountWidth());
+}
+
+TEST(HistogramStorageTest, WidthChangeRevisionTest)
+{
+    Histogram histogram(std::vector<size_t>{3, 1, 2});
+    const uint64_t revision = histogram.revision();
+
+    //Requesting the current width isn't a modification
+    histogram.setCountWidth(CountWidth::Bits64);
+    EXPECT_EQ(revision, histogram.revision());
+
+    histogram.setCountWidth(CountWidth::Bits32);
+    EXPECT_GT(histogram.revision(), revision);
+}
+
+TEST(HistogramStorageTest, WideCountsTest)
+{
+    //Wide counts are handed out for in-place updates, narrow ones aren't
+    HistogramCounts counts(std::vector<size_t>{1, 2, 3});
+    std::vector<size_t>* wideCounts = counts.wideCounts();
+    if constexpr (std::is_same_v<size_t, uint64_t>){
+        ASSERT_NE(nullptr, wideCounts);
+        (*wideCounts)[1] += 5;
+        EXPECT_EQ((std::vector<size_t>{1, 7, 3}), counts);
+    }
+
+    counts.setWidth(CountWidth::Bits32);
+    EXPECT_EQ(nullptr, counts.wideCounts());
+}
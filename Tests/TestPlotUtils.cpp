@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <sstream>
+#include "PlotUtils.h"
+
+
+TEST(PlotUtilsTest, FormatNumberScientificTest)
+{
+    for(const double number : {0.0, -0.0, 1.25, -1.25, 0.000123456, 123456789.0, 1e-300, -9.999e299, 0.5, 2.5}){
+        for(const uint8_t precision : {0, 1, 2, 6, 17}){
+            std::stringstream stream;
+            stream << std::fixed << std::setprecision(precision) << std::scientific << number;
+
+            PlotUtils::NumberTextBuffer buffer;
+            EXPECT_EQ(stream.str(), PlotUtils::format_number(buffer, number, precision));
+        }
+    }
+}
+
+TEST(PlotUtilsTest, FormatNumberFixedTest)
+{
+    for(const double number : {0.0, 1.25, -1.25, 0.000123456, 123456789.0, 1.7976931348623157e308}){
+        for(const uint8_t precision : {0, 1, 3, 255}){
+            std::stringstream stream;
+            stream << std::setprecision(precision) << std::fixed << number;
+
+            PlotUtils::NumberTextBuffer buffer;
+            EXPECT_EQ(stream.str(), PlotUtils::format_number(buffer, number, precision, std::chars_format::fixed));
+        }
+    }
+}
+
+TEST(PlotUtilsTest, FormatNumberGeneralNotationTest)
+{
+    PlotUtils::NumberTextBuffer buffer;
+    ASSERT_THROW(PlotUtils::format_number(buffer, 1.25, 2, std::chars_format::general), std::invalid_argument);
+}
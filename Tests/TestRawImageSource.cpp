@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "rawimagesource.h"
+#include <fstream>
+
+
+namespace {
+    //Writes the image with a header and padded rows. Padding bytes form large values, so reading them would be noticed
+    std::string writeRawFile(const cv::Mat& image, const std::string& name, const size_t stride, const size_t offset)
+    {
+        const std::string path = testing::TempDir() + name;
+        const size_t rowBytes = image.cols * image.elemSize();
+        const std::vector<char> padding(std::max(offset, stride), 0x5A);
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(padding.data(), offset);
+        for(int r = 0; r < image.rows; r++){
+            file.write(image.ptr<char>(r), rowBytes);
+            if(r + 1 < image.rows)
+                file.write(padding.data(), stride - rowBytes);
+        }
+        return path;
+    }
+
+    constexpr RawImageSource::AccessMode ACCESS_MODES[] = {RawImageSource::AccessMode::MemoryMap, RawImageSource::AccessMode::Stream};
+}
+
+TEST(RawImageSourceTest, CountBinsTest)
+{
+    cv::Mat image(300, 257, CV_32F);
+    cv::randu(image, -50, 50);
+    const size_t stride = (image.cols * image.elemSize()) + 12;
+    const std::string path = writeRawFile(image, "countbins.raw", stride, 64);
+
+    for(const auto mode : ACCESS_MODES){
+        RawImageSource source(path, CV_32FC1, image.size(), stride, 64, mode);
+        source.setChunkSize(7 * stride);
+        source.setParallelism(2);
+
+        EXPECT_EQ(HistogramBinning::minMax(image), source.minMax());
+        EXPECT_EQ(HistogramBinning::countBins(image, 37, -40.0F, 45.5F), source.countBins(37, -40.0F, 45.5F));
+    }
+}
+
+TEST(RawImageSourceTest, CreateHistogramTest)
+{
+    for(const int type : {CV_16UC1, CV_32FC1, CV_8UC3}){
+        cv::Mat image(211, 173, type);
+        cv::randu(image, 0, 250);
+        const std::string path = writeRawFile(image, "histogram.raw", image.cols * image.elemSize(), 0);
+        const Histogram expected(image);
+
+        for(const auto mode : ACCESS_MODES){
+            RawImageSource source(path, type, image.size(), 0, 0, mode);
+            source.setChunkSize(1000);
+
+            const Histogram histogram = source.createHistogram();
+            EXPECT_EQ(expected.getHistogram(), histogram.getHistogram());
+            EXPECT_EQ(expected.getBins(), histogram.getBins());
+        }
+    }
+}
+
+TEST(RawImageSourceTest, IllegalArgumentsTest)
+{
+    const cv::Mat image(10, 10, CV_16U, cv::Scalar(3));
+    const std::string path = writeRawFile(image, "small.raw", 20, 0);
+
+    ASSERT_THROW(RawImageSource(path + ".missing", CV_16UC1, image.size()), std::runtime_error);
+    ASSERT_THROW(RawImageSource(path, CV_16UC1, cv::Size(10, 11)), std::invalid_argument);
+    ASSERT_THROW(RawImageSource(path, CV_16UC1, image.size(), 18), std::invalid_argument);
+    ASSERT_THROW(RawImageSource(path, CV_16UC1, image.size(), 0, 1), std::invalid_argument);
+
+    RawImageSource source(path, CV_16UC1, image.size());
+    ASSERT_THROW(source.createHistogram(0), std::invalid_argument);
+    ASSERT_THROW(source.setParallelism(-1), std::invalid_argument);
+}
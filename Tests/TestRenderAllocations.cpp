@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "histogram.h"
+#include "colormap.h"
+#include "emptyspace.h"
+
+
+namespace {
+    //Heap allocations are only counted while a measurement is active
+    std::atomic<bool> countAllocations{false};
+    std::atomic<size_t> heapAllocationCount{0};
+
+    //Counts the matrix buffer allocations and forwards everything else to the standard allocator
+    class CountingMatAllocator : public cv::MatAllocator
+    {
+    public:
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+        {
+            allocationCount++;
+            return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        }
+
+        bool allocate(cv::UMatData* data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override
+        {
+            return cv::Mat::getStdAllocator()->allocate(data, accessflags, usageFlags);
+        }
+
+        void deallocate(cv::UMatData* data) const override
+        {
+            cv::Mat::getStdAllocator()->deallocate(data);
+        }
+
+        mutable std::atomic<size_t> allocationCount{0};
+    };
+}
+
+void* operator new(size_t size)
+{
+    if(countAllocations)
+        heapAllocationCount++;
+
+    if(void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+
+class RenderAllocationTest : public testing::Test
+{
+public:
+    void SetUp() override{
+        cv::Mat::setDefaultAllocator(&m_allocator);
+    };
+
+    void TearDown() override{
+        countAllocations = false;
+        cv::Mat::setDefaultAllocator(nullptr);
+    };
+
+    //Runs the functor and returns the number of matrix and heap allocations it caused
+    template<typename Functor>
+    std::pair<size_t, size_t> countDuring(Functor&& functor){
+        m_allocator.allocationCount = 0;
+        heapAllocationCount = 0;
+
+        countAllocations = true;
+        functor();
+        countAllocations = false;
+
+        return {m_allocator.allocationCount.load(), heapAllocationCount.load()};
+    };
+
+private:
+    CountingMatAllocator m_allocator;
+};
+
+TEST_F(RenderAllocationTest, HistogramRepeatedRenderDoesntAllocateTest)
+{
+    Histogram hist(std::vector<size_t>{1, 4, 9, 16, 25, 16, 9, 4, 1}, 0.0F, 9.0F);
+    hist.setText(TextField::Title, "Histogram");
+    hist.setText(TextField::XAxis, "Values");
+    hist.setCanvasSize({640, 480});
+
+    //First renders fill the text caches and allocate the frames. The frames belong to the test, so every call draws them again
+    cv::Mat frame, otherFrame;
+    hist.generate(frame);
+    hist.generate(otherFrame);
+    const uchar* frameData = frame.data;
+
+    const auto[matAllocations, heapAllocations] = countDuring([&](){ hist.generate(frame); });
+    EXPECT_EQ(0U, matAllocations);
+    EXPECT_EQ(0U, heapAllocations);
+    EXPECT_EQ(frameData, frame.data);
+}
+
+TEST_F(RenderAllocationTest, ColormapRepeatedRenderDoesntAllocateTest)
+{
+    cv::Mat target(64, 48, CV_32F);
+    cv::randu(target, -1.0, 1.0);
+
+    Colormap colormap(target, -0.5, 0.5);
+    colormap.setText(TextField::Title, "Colormap");
+    colormap.setText(TextField::XAxis, "Columns");
+    colormap.setCanvasSize({640, 480});
+
+    //First renders fill the text caches and allocate the frames. The frames belong to the test, so every call draws them again
+    cv::Mat frame, otherFrame;
+    colormap.generate(frame);
+    colormap.generate(otherFrame);
+    const uchar* frameData = frame.data;
+
+    const auto[matAllocations, heapAllocations] = countDuring([&](){ colormap.generate(frame); });
+    EXPECT_EQ(0U, matAllocations);
+    EXPECT_EQ(0U, heapAllocations);
+    EXPECT_EQ(frameData, frame.data);
+}
+
+TEST_F(RenderAllocationTest, ColormapUpdateDoesntAllocateTest)
+{
+    cv::Mat target(64, 48, CV_32F);
+    cv::randu(target, -1.0, 1.0);
+
+    Colormap colormap(target, -0.5, 0.5);
+    colormap.setText(TextField::Title, "Colormap");
+    colormap.setCanvasSize({640, 480});
+
+    const cv::Mat frame = colormap.generate();
+
+    //Updates write the colormap area of the kept canvas
+    cv::randu(target, -1.0, 1.0);
+    const size_t matAllocations = countDuring([&](){ colormap.update(target); }).first;
+    EXPECT_EQ(0U, matAllocations);
+    EXPECT_EQ(frame.data, colormap.generate().data);
+}
+
+TEST_F(RenderAllocationTest, WaterfallAppendDoesntAllocateTest)
+{
+    Colormap waterfall = Colormap::waterfall(64, 48, 0.0, 1.0);
+    waterfall.setText(TextField::Title, "Waterfall");
+
+    const cv::Mat frame = waterfall.generate();
+
+    //Appended rows are colorized in the ring and composed into the kept canvas
+    cv::Mat row(1, 64, CV_32F);
+    cv::randu(row, 0.0, 1.0);
+    const size_t matAllocations = countDuring([&](){ waterfall.appendRow(row); }).first;
+    EXPECT_EQ(0U, matAllocations);
+
+    cv::Mat rendered;
+    waterfall.generate(rendered);
+    EXPECT_EQ(0, cv::norm(rendered, frame, cv::NORM_L1));
+}
+
+TEST_F(RenderAllocationTest, RenderIntoSubmatrixTest)
+{
+    Histogram hist(std::vector<size_t>{3, 1, 2});
+    hist.setCanvasSize({320, 240});
+
+    //Once the canvas size is known, the element can be rendered into a part of a larger canvas
+    cv::Mat reference = hist.generate();
+    cv::Mat frame(reference.rows + 20, reference.cols + 20, CV_8UC3, cv::Scalar(0, 0, 255));
+    cv::Mat area = frame(cv::Rect(10, 10, reference.cols, reference.rows));
+    const uchar* areaData = area.data;
+    hist.generate(area);
+
+    EXPECT_EQ(areaData, area.data);
+    EXPECT_EQ(0, cv::norm(reference, frame(cv::Rect(10, 10, reference.cols, reference.rows)), cv::NORM_L1));
+    EXPECT_EQ(cv::Vec3b(0, 0, 255), frame.at<cv::Vec3b>(0, 0));
+}
+
+TEST_F(RenderAllocationTest, UnchangedElementIsNotRenderedAgainTest)
+{
+    Histogram hist(std::vector<size_t>{3, 1, 2});
+    hist.setText(TextField::Title, "Title");
+
+    const cv::Mat first = hist.generate();
+    const uchar* secondData = nullptr;
+    const auto[matAllocations, heapAllocations] = countDuring([&](){ secondData = hist.generate().data; });
+    EXPECT_EQ(first.data, secondData);
+    EXPECT_EQ(0U, matAllocations);
+    EXPECT_EQ(0U, heapAllocations);
+
+}
+
+TEST_F(RenderAllocationTest, CallerBufferIsAlwaysDrawnTest)
+{
+    Histogram hist(std::vector<size_t>{3, 1, 2});
+    hist.setText(TextField::Title, "Title");
+    const cv::Mat reference = hist.generate().clone();
+
+    //Buffers of the caller are drawn again on every call, whatever the caller has drawn on them
+    cv::Mat frame;
+    hist.generate(frame);
+    frame.at<cv::Vec3b>(0, 0) = cv::Vec3b(0, 0, 255);
+    hist.generate(frame);
+    EXPECT_EQ(0, cv::norm(reference, frame, cv::NORM_L1));
+
+    //The element never returns the buffer of the caller as its own canvas
+    hist.setText(TextField::Title, "Other title");
+    hist.generate(frame);
+    EXPECT_NE(frame.data, hist.generate().data);
+}
+
+TEST_F(RenderAllocationTest, ModificationInvalidatesCanvasTest)
+{
+    Histogram hist(std::vector<size_t>{3, 1, 2});
+    const cv::Mat first = hist.generate();
+
+    //Setters assign a new revision and the previously returned canvas stays intact
+    const uint64_t revision = hist.revision();
+    hist.setText(TextField::Title, "Title");
+    EXPECT_GT(hist.revision(), revision);
+
+    const cv::Mat second = hist.generate();
+    EXPECT_NE(first.data, second.data);
+
+    //Setting the same canvas size isn't a modification
+    const uint64_t secondRevision = hist.revision();
+    hist.setCanvasSize(hist.getCanvasSize());
+    EXPECT_EQ(secondRevision, hist.revision());
+    EXPECT_EQ(second.data, hist.generate().data);
+
+    hist.setCanvasSize(hist.getCanvasSize() + cv::Size(10, 10));
+    EXPECT_NE(second.data, hist.generate().data);
+}
+
+TEST_F(RenderAllocationTest, EmptySpaceRevisionTest)
+{
+    EmptySpace space;
+    space.setCanvasSize({16, 8});
+
+    const cv::Mat first = space.generate();
+    EXPECT_EQ(first.data, space.generate().data);
+
+    space.setCanvasSize({8, 16});
+    EXPECT_EQ(cv::Size(8, 16), space.generate().size());
+}
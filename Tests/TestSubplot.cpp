@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "subplot.h"
+
+
+class SubplotGrid : public testing::Test
+{
+public:
+    void SetUp() override{
+        cv::Mat data(120, 80, CV_32F);
+        cv::randn(data, 0, 20);
+
+        for(int i = 0; i < 4; i++){
+            Histogram hist(data, 30);
+            hist.setText(TextField::Title, "Histogram " + std::to_string(i));
+            elements.emplace_back(std::move(hist));
+
+            Colormap colormap(data);
+            colormap.setText(TextField::XAxis, "Colormap " + std::to_string(i));
+            elements.emplace_back(std::move(colormap));
+        }
+    };
+    std::vector<Plottable> getElements() const {return elements;};
+
+private:
+    std::vector<Plottable> elements;
+};
+
+TEST(SubplotTest, ConstructorMismatchedGridTest)
+{
+    std::vector<Plottable> elements{EmptySpace(), EmptySpace(), EmptySpace()};
+    ASSERT_ANY_THROW(Subplot(elements, 2, 2));
+}
+
+TEST_F(SubplotGrid, ParallelRenderMatchesSerialTest)
+{
+    Subplot serial(getElements(), 2, 4);
+    serial.setParallelism(1);
+    const cv::Mat serialCanvas = serial.generate();
+
+    Subplot parallel(getElements(), 2, 4);
+    parallel.setParallelism(0);
+    const cv::Mat parallelCanvas = parallel.generate();
+
+    ASSERT_EQ(serialCanvas.size(), parallelCanvas.size());
+    EXPECT_EQ(0, cv::norm(serialCanvas, parallelCanvas, cv::NORM_L1));
+}
+
+TEST_F(SubplotGrid, CappedParallelismTest)
+{
+    Subplot serial(getElements(), 4, 2);
+    serial.setParallelism(1);
+
+    Subplot capped(getElements(), 4, 2);
+    capped.setParallelism(3);
+
+    EXPECT_EQ(0, cv::norm(serial.generate(), capped.generate(), cv::NORM_L1));
+}
+
+TEST(SubplotTest, NegativeParallelismTest)
+{
+    Subplot subplot({EmptySpace()}, 1, 1);
+    ASSERT_THROW(subplot.setParallelism(-1), std::invalid_argument);
+}
+
+TEST(SubplotTest, ElementRenderedIntoCellTest)
+{
+    Histogram hist(std::vector<size_t>{4, 2, 7, 1});
+    hist.setCanvasSize({300, 250});
+    const cv::Size requiredSize = hist.requiredCanvasSize();
+
+    //The subplot holds a copy of the element, which has its own revision
+    Subplot subplot({hist}, 1, 1);
+    const auto lambda_getState = [](const auto& element){ return std::make_pair(element.getCanvasSize(), element.revision()); };
+    const uint64_t revision = std::visit(lambda_getState, subplot[0]).second;
+    const cv::Mat canvas = subplot.generate();
+    ASSERT_EQ(subplot.requiredCanvasSize(), canvas.size());
+
+    //The single cell holds exactly what the element renders on its own
+    const cv::Mat reference = hist.generate();
+    ASSERT_EQ(requiredSize, reference.size());
+    const cv::Mat cell = canvas(cv::Rect(10, 10, reference.cols, reference.rows));
+    EXPECT_EQ(0, cv::norm(reference, cell, cv::NORM_L1));
+
+    //Placing the element into its cell doesn't modify it
+    EXPECT_EQ(std::make_pair(cv::Size(300, 250), revision), std::visit(lambda_getState, subplot[0]));
+}
+
+TEST(SubplotTest, ElementCanvasDoesntAliasCellTest)
+{
+    //The element has the size of its cell, so it would be up to date at its own size after the subplot render
+    auto hist = std::make_shared<Plottable>(Histogram(std::vector<size_t>{4, 2, 7, 1}));
+    std::get<Histogram>(*hist).setCanvasSize({300, 250});
+    Subplot subplot({hist}, 1, 1);
+    subplot.setCellSize(cv::Size(300, 250));
+
+    const cv::Mat canvas = subplot.generate();
+    EXPECT_TRUE(std::get<Histogram>(*hist).canvas().empty());
+
+    //The element renders a canvas of its own, which the next subplot render doesn't overwrite
+    const cv::Mat element = std::get<Histogram>(*hist).generate();
+    EXPECT_TRUE(element.data < canvas.datastart || element.data >= canvas.dataend);
+    EXPECT_EQ(0, cv::norm(element, canvas(cv::Rect(10, 10, 300, 250)), cv::NORM_L1));
+}
+
+TEST(SubplotTest, SharedElementModificationTest)
+{
+    auto hist = std::make_shared<Plottable>(Histogram(std::vector<size_t>{4, 2, 7, 1}));
+    auto space = std::make_shared<Plottable>(EmptySpace());
+    Subplot subplot({hist, space}, 1, 2);
+
+    const cv::Mat first = subplot.generate();
+    EXPECT_EQ(first.data, subplot.generate().data);
+
+    //Modifying the element through its handle invalidates the subplot canvas
+    std::get<Histogram>(*hist).setText(TextField::Title, "Modified");
+    const cv::Mat second = subplot.generate();
+    EXPECT_NE(first.data, second.data);
+    EXPECT_EQ(hist.get(), subplot.element(0).get());
+}
+
+TEST(SubplotTest, ReplacedElementTest)
+{
+    //The replacing element is older than the replaced one, the replacement is still a modification
+    Histogram older(std::vector<size_t>{9, 1, 9});
+    auto hist = std::make_shared<Plottable>(Histogram(std::vector<size_t>{4, 2, 7, 1}));
+    Subplot subplot({hist}, 1, 1);
+    const cv::Mat first = subplot.generate();
+
+    const uint64_t revision = subplot.revision();
+    *hist = older;
+    EXPECT_GT(subplot.revision(), revision);
+    EXPECT_GT(std::get<Histogram>(*hist).revision(), older.revision());
+
+    const cv::Mat second = subplot.generate();
+    EXPECT_NE(first.data, second.data);
+    EXPECT_EQ(0, cv::norm(older.generate(), second(cv::Rect(10, 10, older.requiredCanvasSize().width, older.requiredCanvasSize().height)), cv::NORM_L1));
+}
+
+TEST(SubplotTest, MoveConstructorTest)
+{
+    cv::Mat data(64, 64, CV_8U, cv::Scalar(3));
+    Colormap colormap(data, 0, 10);
+    colormap.generate();
+    std::vector<Plottable> elements;
+    elements.emplace_back(std::move(colormap));
+    const uchar* colormapData = std::get<Colormap>(elements[0]).canvas().data;
+    ASSERT_NE(nullptr, colormapData);
+
+    //Element buffers are handed over to the subplot instead of being copied
+    Subplot subplot(std::move(elements), 1, 1);
+    EXPECT_EQ(colormapData, std::get<Colormap>(subplot[0]).canvas().data);
+    EXPECT_NO_THROW(subplot.generate());
+}
+
+TEST(SubplotTest, RepeatedElementTest)
+{
+    auto hist = std::make_shared<Plottable>(Histogram(std::vector<size_t>{4, 2, 7, 1}));
+    Subplot subplot({hist, hist, hist, hist}, 2, 2);
+
+    const cv::Mat canvas = subplot.generate();
+    const cv::Size cellSize = std::get<Histogram>(*hist).requiredCanvasSize();
+    const cv::Mat firstCell = canvas(cv::Rect(10, 10, cellSize.width, cellSize.height));
+    const cv::Mat lastCell = canvas(cv::Rect(10 + cellSize.width, 10 + cellSize.height, cellSize.width, cellSize.height));
+    EXPECT_EQ(0, cv::norm(firstCell, lastCell, cv::NORM_L1));
+}
+
+TEST(SubplotTest, RepeatedNestedElementTest)
+{
+    //The same handle is placed into a cell and into a nested subplot, so the cells are rendered serially
+    auto hist = std::make_shared<Plottable>(Histogram(std::vector<size_t>{4, 2, 7, 1}));
+    auto nested = std::make_shared<Plottable>(Subplot(std::vector<std::shared_ptr<Plottable>>{hist, std::make_shared<Plottable>(EmptySpace())}, 1, 2));
+
+    Subplot parallel({hist, nested}, 1, 2);
+    parallel.setParallelism(0);
+    Subplot serial({hist, nested}, 1, 2);
+    serial.setParallelism(1);
+
+    EXPECT_EQ(0, cv::norm(serial.generate(), parallel.generate(), cv::NORM_L1));
+}
+
+TEST(SubplotTest, CloneDoesntShareElementsTest)
+{
+    auto hist = std::make_shared<Plottable>(Histogram(std::vector<size_t>{4, 2, 7, 1}));
+    Subplot subplot({hist}, 1, 1);
+
+    const Subplot copy = subplot;
+    const Subplot clone = subplot.clone();
+    EXPECT_EQ(hist.get(), copy.element(0).get());
+    EXPECT_NE(hist.get(), clone.element(0).get());
+}
+
+TEST(SubplotTest, NullElementTest)
+{
+    ASSERT_THROW(Subplot(std::vector<std::shared_ptr<Plottable>>{nullptr}, 1, 1), std::invalid_argument);
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "textrastercache.h"
+#include "glyphatlas.h"
+#include "textmetrics.h"
+#include "plotelementbase.h"
+
+
+class TextRasterCacheTest : public testing::Test
+{
+public:
+    void SetUp() override{
+        TextRasterCache::instance().clear();
+        TextRasterCache::instance().setCapacity(TextRasterCache::DEFAULT_CAPACITY);
+        TextRasterCache::instance().resetStatistics();
+    };
+
+    void TearDown() override{
+        SetUp();
+    };
+
+    cv::Mat render(const std::string_view text, int& renderCount) const{
+        const auto lambda_render = [&renderCount](){ renderCount++; return cv::Mat(10, 20, CV_8UC3, PainterConstants::white); };
+        return TextRasterCache::instance().getOrRender(text, 0.3F, PainterConstants::black, PainterConstants::font, lambda_render);
+    };
+};
+
+TEST_F(TextRasterCacheTest, RepeatedTextRenderedOnceTest)
+{
+    int renderCount = 0;
+    const cv::Mat first = render("1.2e+00", renderCount);
+    const cv::Mat second = render("1.2e+00", renderCount);
+
+    EXPECT_EQ(1, renderCount);
+    EXPECT_EQ(first.data, second.data);
+    EXPECT_EQ(1U, TextRasterCache::instance().hits());
+    EXPECT_EQ(1U, TextRasterCache::instance().misses());
+}
+
+TEST_F(TextRasterCacheTest, DifferentKeysRenderedSeparatelyTest)
+{
+    int renderCount = 0;
+    static_cast<void>(render("1.2e+00", renderCount));
+    static_cast<void>(TextRasterCache::instance().getOrRender("1.2e+00", 0.4F, PainterConstants::black, PainterConstants::font, [&renderCount](){ renderCount++; return cv::Mat(1, 1, CV_8UC3); }));
+    static_cast<void>(TextRasterCache::instance().getOrRender("1.2e+00", 0.3F, PainterConstants::blue, PainterConstants::font, [&renderCount](){ renderCount++; return cv::Mat(1, 1, CV_8UC3); }));
+
+    EXPECT_EQ(3, renderCount);
+    EXPECT_EQ(3U, TextRasterCache::instance().size());
+}
+
+TEST_F(TextRasterCacheTest, LeastRecentlyUsedEvictionTest)
+{
+    TextRasterCache::instance().setCapacity(2);
+
+    int renderCount = 0;
+    static_cast<void>(render("a", renderCount));
+    static_cast<void>(render("b", renderCount));
+    static_cast<void>(render("a", renderCount));
+    static_cast<void>(render("c", renderCount));
+
+    //"b" is the least recently used entry, so it should be rendered again
+    static_cast<void>(render("a", renderCount));
+    static_cast<void>(render("b", renderCount));
+
+    EXPECT_EQ(4, renderCount);
+    EXPECT_EQ(2U, TextRasterCache::instance().size());
+}
+
+TEST_F(TextRasterCacheTest, DisabledCacheTest)
+{
+    TextRasterCache::instance().setCapacity(0);
+
+    int renderCount = 0;
+    static_cast<void>(render("1.2e+00", renderCount));
+    static_cast<void>(render("1.2e+00", renderCount));
+
+    EXPECT_EQ(2, renderCount);
+    EXPECT_EQ(0U, TextRasterCache::instance().size());
+}
+
+TEST(GlyphAtlasTest, NumericGlyphsTest)
+{
+    EXPECT_TRUE(GlyphAtlas::canRender("-1.25e+03"));
+    EXPECT_FALSE(GlyphAtlas::canRender("inf"));
+    EXPECT_FALSE(GlyphAtlas::canRender(""));
+}
+
+TEST(GlyphAtlasTest, MatchesStrokeRenderingTest)
+{
+    constexpr float FONT_SIZE = 0.3F;
+    constexpr int CANVAS_HEIGHT = 12;
+    constexpr int MARGIN = 3;
+    const std::string label = "-1.25e+03";
+
+    const int textWidth = TextMetrics::textSize(label, FONT_SIZE, PainterConstants::font, 1).width;
+    const cv::Size canvasSize{textWidth + (2 * MARGIN), CANVAS_HEIGHT};
+    const cv::Mat atlasText = GlyphAtlas::instance().renderText(label, FONT_SIZE, PainterConstants::blue, PainterConstants::font, canvasSize, MARGIN);
+
+    //Render the same label with a single putText call on the same layout
+    cv::Mat reference(canvasSize, CV_8UC3, PainterConstants::white);
+    cv::putText(reference, label, cv::Point{MARGIN, CANVAS_HEIGHT - MARGIN}, PainterConstants::font, FONT_SIZE, PainterConstants::blue, 1, cv::LINE_AA);
+
+    //Only the ink placement may differ slightly because the glyphs are snapped to whole pixels
+    ASSERT_EQ(canvasSize, atlasText.size());
+    const double meanDifference = cv::norm(atlasText, reference, cv::NORM_L1) / static_cast<double>(atlasText.total() * atlasText.channels());
+    EXPECT_LT(meanDifference, 16.0);
+}
+
+TEST(TextMetricsTest, MatchesGetTextSizeTest)
+{
+    for(const std::string text : {"Histogram Example", "-1.25e+03", "x", "Uniform Distribution X-Axis"}){
+        for(const double fontScale : {0.3, 0.4, 0.8, 1.3}){
+            int expectedBaseline = 0;
+            int baseline = 0;
+            const cv::Size expected = cv::getTextSize(text, PainterConstants::font, fontScale, 1, &expectedBaseline);
+
+            EXPECT_EQ(expected, TextMetrics::textSize(text, fontScale, PainterConstants::font, 1, &baseline));
+            EXPECT_EQ(expectedBaseline, baseline);
+        }
+    }
+}
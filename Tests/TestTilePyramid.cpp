@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "tilepyramid.h"
+#include "colormap.h"
+#include "opencv2/core/utility.hpp"
+
+
+TEST(TilePyramidTest, LevelsTest)
+{
+    const cv::Mat source(1000, 3000, CV_16U, cv::Scalar(0));
+    const TilePyramid pyramid(source, 0, 100, Downsampling::Area, 256);
+
+    //3000 -> 1500 -> 750 -> 375 -> 188, which fits into a tile
+    EXPECT_EQ(5, pyramid.getLevelCount());
+    EXPECT_EQ(0U, pyramid.computedTiles());
+}
+
+TEST(TilePyramidTest, FullResolutionViewportTest)
+{
+    cv::Mat source(700, 900, CV_32F);
+    cv::randu(source, -10, 10);
+    TilePyramid pyramid(source, -5.0, 5.0, Downsampling::Area, 128);
+
+    //A viewport rendered at its own size comes from the first level and crosses tile borders
+    const cv::Rect viewport(100, 200, 300, 250);
+    cv::Mat expected;
+    ColormapKernel::quantize(source(viewport), -5.0, 5.0, expected);
+    cv::Mat rendered;
+    pyramid.render(viewport, viewport.size(), rendered);
+    EXPECT_EQ(0, cv::norm(expected, rendered, cv::NORM_INF));
+}
+
+TEST(TilePyramidTest, OnlyCoveringTilesTest)
+{
+    const cv::Mat source(4096, 4096, CV_8U, cv::Scalar(7));
+    TilePyramid pyramid(source, 0, 255, Downsampling::Area, 256);
+
+    //The viewport spans 3x3 tiles of the first level
+    cv::Mat rendered;
+    pyramid.render(cv::Rect(1000, 1000, 300, 300), cv::Size(300, 300), rendered);
+    EXPECT_EQ(9U, pyramid.computedTiles());
+
+    //Cached tiles aren't computed again while panning within them
+    pyramid.render(cv::Rect(1010, 990, 300, 300), cv::Size(300, 300), rendered);
+    EXPECT_EQ(9U, pyramid.computedTiles());
+
+    //Evicted tiles are computed again
+    pyramid.setCapacity(4);
+    EXPECT_EQ(4U, pyramid.size());
+    pyramid.render(cv::Rect(1000, 1000, 300, 300), cv::Size(300, 300), rendered);
+    EXPECT_GT(pyramid.computedTiles(), 9U);
+}
+
+TEST(TilePyramidTest, ZoomedOutViewportTest)
+{
+    //A single pixel feature survives every level of a maximum preserving pyramid
+    cv::Mat source(2000, 2000, CV_32F, cv::Scalar(0));
+    source.at<float>(1234, 567) = 1.0F;
+    TilePyramid pyramid(source, {}, {}, Downsampling::Max, 128);
+    EXPECT_EQ(std::make_pair(0.0, 1.0), pyramid.getRange());
+
+    cv::Mat rendered;
+    pyramid.render(cv::Rect(0, 0, 2000, 2000), cv::Size(100, 100), rendered);
+    ASSERT_EQ(cv::Size(100, 100), rendered.size());
+    double maxIndex{};
+    cv::minMaxLoc(rendered, nullptr, &maxIndex);
+    EXPECT_EQ(255, maxIndex);
+
+    //Zooming out again only touches the cached coarse tiles
+    const size_t computedTiles = pyramid.computedTiles();
+    pyramid.render(cv::Rect(0, 0, 2000, 2000), cv::Size(120, 120), rendered);
+    EXPECT_EQ(computedTiles, pyramid.computedTiles());
+}
+
+TEST(TilePyramidTest, IllegalArgumentsTest)
+{
+    const cv::Mat source(100, 100, CV_8U, cv::Scalar(1));
+    ASSERT_THROW(TilePyramid(cv::Mat()), std::invalid_argument);
+    ASSERT_THROW(TilePyramid(source, 10, 1), std::invalid_argument);
+    ASSERT_THROW(TilePyramid(source, {}, {}, Downsampling::Area, 0), std::invalid_argument);
+
+    TilePyramid pyramid(source);
+    cv::Mat rendered;
+    ASSERT_THROW(pyramid.render(cv::Rect(50, 50, 60, 10), cv::Size(10, 10), rendered), std::invalid_argument);
+    ASSERT_THROW(pyramid.render(cv::Rect(0, 0, 10, 10), cv::Size(0, 10), rendered), std::invalid_argument);
+}
+
+TEST(TilePyramidTest, ColormapViewportTest)
+{
+    cv::Mat source(5000, 8000, CV_16U);
+    cv::randu(source, 0, 1000);
+    const auto pyramid = std::make_shared<TilePyramid>(source, 0, 1000);
+
+    Colormap colormap(pyramid);
+    colormap.setCanvasSize({640, 480});
+    EXPECT_EQ(cv::Size(640, 480), colormap.requiredCanvasSize());
+    EXPECT_EQ(cv::Size(640, 480), colormap.generate().size());
+
+    //Zooming in only computes the tiles of the viewport
+    colormap.setViewport(cv::Rect(4000, 2000, 400, 300));
+    const size_t computedTiles = pyramid->computedTiles();
+    colormap.generate();
+    EXPECT_LE(pyramid->computedTiles() - computedTiles, 9U);
+
+    ASSERT_THROW(colormap.setViewport(cv::Rect(7900, 0, 200, 100)), std::invalid_argument);
+}
+
+TEST(TilePyramidTest, ConcurrentRenderTest)
+{
+    cv::Mat source(2000, 3000, CV_32F);
+    cv::randu(source, 0, 1);
+
+    //Viewports of a shared pyramid are rendered concurrently with a small cache, so tiles are evicted while they are used
+    const std::vector<cv::Rect> viewports{cv::Rect(0, 0, 3000, 2000), cv::Rect(100, 200, 900, 700), cv::Rect(1500, 1000, 1400, 900), cv::Rect(0, 0, 3000, 2000),
+                                          cv::Rect(800, 300, 400, 300), cv::Rect(2000, 1200, 1000, 800)};
+    TilePyramid shared(source, 0.0, 1.0, Downsampling::Area, 128);
+    shared.setCapacity(16);
+    std::vector<cv::Mat> rendered(viewports.size());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(viewports.size())), [&](const cv::Range& range){
+        for(int i = range.start; i < range.end; i++){
+            shared.render(viewports[i], cv::Size(300, 200), rendered[i]);
+        }
+    });
+    EXPECT_LE(shared.size(), 16U);
+
+    for(size_t i = 0; i < viewports.size(); i++){
+        TilePyramid serial(source, 0.0, 1.0, Downsampling::Area, 128);
+        cv::Mat expected;
+        serial.render(viewports[i], cv::Size(300, 200), expected);
+        EXPECT_EQ(0, cv::norm(expected, rendered[i], cv::NORM_L1));
+    }
+}
@@ -2,9 +2,13 @@
 #define PLOTUTILS_H
 
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
 #include <iterator>
 #include <optional>
 #include <stdexcept>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 #endif // PLOTUTILS_H
@@ -71,6 +75,58 @@ static std::vector<T> linspace(const T start, const T end, const std::optional<s
     return out;
 };
 
+//Longest possible output: sign, 309 integer digits of the largest double, decimal point and 255 fractional digits
+constexpr size_t NUMBER_TEXT_BUFFER_SIZE = 576;
+using NumberTextBuffer = std::array<char, NUMBER_TEXT_BUFFER_SIZE>;
+
+/**
+    * @brief This utility function formats a floating point number into a stack buffer without any heap allocation. The output is byte-identical to
+    * the output of a std::ostream that has been set with std::scientific (or std::fixed) and std::setprecision(precision)
+    * @param buffer: storage of the formatted text. The returned view points to this buffer
+    * @param number: number to be formatted
+    * @param precision: number of the digits after the decimal point
+    * @param format: either std::chars_format::scientific or std::chars_format::fixed
+    * @return A view to the formatted text
+    */
+static std::string_view format_number(NumberTextBuffer& buffer, const double number, const uint8_t precision, const std::chars_format format = std::chars_format::scientific)
+{
+    //Only the printf-like notations have a fixed number of fractional digits
+    if(format != std::chars_format::scientific && format != std::chars_format::fixed)
+        throw(std::invalid_argument("Only scientific and fixed notations are supported"));
+
+    const auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number, format, precision);
+    if(error != std::errc())
+        throw(std::runtime_error("Number cannot be formatted"));
+
+    return std::string_view(buffer.data(), static_cast<size_t>(end - buffer.data()));
+};
+
+/**
+    * @brief This utility function applies "functor" on the same elements that "linspace" generates, without storing them in a vector
+    * @param start: start point of the range. The value is always included
+    * @param end: end point of the range. The value is always included
+    * @param count: number of the elements
+    * @param functor: functor that takes the element type as a parameter
+    */
+template <typename T, typename Lambda>
+static void linspace_for_each(const T start, const T end, const size_t count, Lambda&& functor)
+{
+    static_assert(std::is_arithmetic_v<T>);
+    static_assert(std::is_invocable<Lambda, T>::value);
+
+    //Handle illegal cases
+    if(count == 0)
+        throw(std::runtime_error("Range cannot be zero"));
+
+    //Follows the exact arithmetic of "linspace", so that the elements are identical
+    const double inc = static_cast<double>(end - start) / std::max(count - 1, static_cast<size_t>(1));
+    double curValue = start - inc;
+    for(size_t i = 0; i < count - 1; i++){
+        functor(static_cast<T>(curValue += inc));
+    }
+    functor(end);
+};
+
 template<size_t S>
 static constexpr std::array<double, S> linspace(const float start, const float end)
 {
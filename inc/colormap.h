@@ -1,6 +1,9 @@
 #ifndef COLORMAP_H
 #define COLORMAP_H
 #include "plotelementbase.h"
+#include "colormapkernel.h"
+#include "tilepyramid.h"
+#include <memory>
 #include <optional>
 
 class Colormap : public PlotElementBase
@@ -25,29 +28,134 @@ public:
              const std::optional<double> colormap_max={},
              const cv::ColormapTypes colormapType=cv::ColormapTypes::COLORMAP_JET);
 
+    /**
+    * @brief Constructor variant for sources that are too large to be rendered as a whole. Only the viewport is rendered, from the tiles of the pyramid
+    * that cover it, so the cost of a render doesn't depend on the size of the source. The colormap range is the range of the pyramid
+    * @param pyramid: The tile pyramid of the source, see TilePyramid. It's shared by the copies of the colormap
+    * @param colormapType: The colormap to apply, see ColormapTypes from the OpenCV library
+    */
+    explicit Colormap(const std::shared_ptr<TilePyramid>& pyramid, const cv::ColormapTypes colormapType=cv::ColormapTypes::COLORMAP_JET);
+
+    /**
+    * @brief Creates a scrolling waterfall, such as a spectrogram, which displays the last appended rows from the oldest at the top to the newest
+    * at the bottom. Rows are kept in a ring, so appending a row doesn't move the history. Rows that haven't been appended yet show the minimum border
+    * @param width: Number of the values of each row
+    * @param rowCount: Number of the displayed rows
+    * @param colormap_min: Minimum border of the colormap
+    * @param colormap_max: Maximum border of the colormap
+    * @param colormapType: The colormap to apply, see ColormapTypes from the OpenCV library
+    */
+    static Colormap waterfall(const int width, const int rowCount, const double colormap_min, const double colormap_max,
+                              const cv::ColormapTypes colormapType=cv::ColormapTypes::COLORMAP_JET);
+
     /**
     * @brief Generates the colormap canvas by using the parameters that have been given.
     * @return The colormap canvas that has been generated.
     */
     cv::Mat generate();
 
-    void setColorbarPrecision(const uint8_t precision) {m_colorbarPrecision = precision;};
+    /**
+    * @brief Generates the colormap canvas directly into the given buffer. If "out" already has the size of the canvas and the CV_8UC3 type,
+    * its buffer is reused (this also holds for a submatrix of a larger canvas). Once the texts are cached, repeated calls don't allocate.
+    * The buffer stays the caller's, it is drawn on every call and isn't kept by the element.
+    * @param out: the buffer that the canvas will be drawn into
+    */
+    void generate(cv::Mat& out);
+
+    /**
+    * @brief Replaces the data of the colormap with a new frame of the same size, keeping the range and every other setting. If the canvas is
+    * up to date, only its colormap area is colorized again and the decorations are kept. The canvas that has been generated last is rewritten
+    * in place, along with any buffer it has been drawn into, so it shows the new frame without another render. The revision changes either way,
+    * and the rewritten canvas is up to date for the new one. Otherwise the frame is shown by the next render. Copies of the colormap keep
+    * their data, buffers that are shared with them are replaced before they are written
+    * @param frame: single channel matrix with the size of the colormap. Like the range constructor does, its values are truncated to the colormap
+    * range and normalized over the truncated extremes. Frames of waterfalls are scaled to the colormap range like the appended rows
+    */
+    void update(const cv::Mat& frame);
+
+    /**
+    * @brief Appends a row to the waterfall, which replaces its oldest row. Only the appended row is colorized, if the canvas is up to date its
+    * colormap area is composed again in place like update does, which changes the revision as well. Copies of the waterfall keep their rows.
+    * Waterfalls that are displayed with their own size only copy the colorized rows, scaled waterfalls resample and colorize the whole
+    * colormap area on every append
+    * @param row: single channel matrix with a single row of the width of the waterfall. Its values are scaled to the colormap range
+    */
+    void appendRow(const cv::Mat& row);
+
+    bool isWaterfall() const {return !m_ringColors.empty();};
+
+    /**
+    * @brief Calculates the size of the canvas that generate will produce, without rendering anything
+    */
+    cv::Size requiredCanvasSize();
+
+    void setColorbarPrecision(const uint8_t precision) {m_colorbarPrecision = precision; markModified();};
+
+    /**
+    * @brief Sets how the colormap is shrunk when it's displayed smaller than its size, see Downsampling. With any downsampling but None,
+    * the canvas doesn't have to fit every pixel of the colormap
+    */
+    void setDownsampling(const Downsampling downsampling);
+
+    /**
+    * @brief Sets the part of the colormap to be displayed, which pans and zooms the colormap. The axes show the source coordinates of the viewport
+    * @param sourceRect: the viewport in source pixels, it should lie within the colormap. Waterfalls are always displayed as a whole
+    */
+    void setViewport(const cv::Rect& sourceRect);
+    const cv::Rect& getViewport() const {return m_viewport;};
 
     Colormap clone() const;
 
 private:
+    //Waterfall constructor, see Colormap::waterfall
+    Colormap(const cv::Size& size, const std::pair<double, double>& colormapRange, const cv::ColormapTypes colormapType);
+
     cv::Size calculateMinimumCanvasSize(const cv::Size titleCanvasSize, const cv::Size xAxisCanvasSize);
 
-    cv::Mat generateColormapCanvas(const int titleCanvasHeight, const int xAxisCanvasHeight) const;
-    cv::Mat generateColorbar(const int colormapHeight) const;
+    /**
+    * @brief Draws the whole canvas into "out"
+    * @return Area of the colormap on the canvas
+    */
+    cv::Rect drawCanvas(cv::Mat& out);
 
-    cv::Mat resizeColormap(const int titleCanvasHeight, const int xAxisCanvasHeight) const;
+    cv::Rect drawColormapCanvas(cv::Mat& out, const cv::Size& colormapSize);
+    void drawColorbar(cv::Mat& out);
+
+    /**
+    * @brief Fits the displayed indices to the colormap area and colorizes them into the area
+    * @param isDataModified: true if the indices have been modified since the area has been drawn
+    */
+    void drawColormapArea(cv::Mat& area, const bool isDataModified);
+    void redrawColormapArea();
+    void resampleRing(const cv::Size& size);
+
+    cv::Size colormapDisplaySize(const int titleCanvasHeight, const int xAxisCanvasHeight) const;
+    cv::Size minimumColormapDisplaySize() const;
 
     int colorbarTotalWidth() const;
     int totalHeightPadding() const;
 
 private:
-    cv::Mat m_colormap;
+    //Normalized CV_8U indices of the colormap and the colors of the indices. Colors are only looked up for the displayed pixels
+    cv::Mat m_indices;
+    cv::Mat m_lookupTable;
+
+    //Source of the indices of very large colormaps, which is used instead of m_indices
+    std::shared_ptr<TilePyramid> m_pyramid;
+    cv::Rect m_viewport;
+
+    //Colors of the rows of waterfalls. Indices of waterfalls are a ring of rows, the ring head is the oldest row which is replaced next
+    cv::Mat m_ringColors;
+    int m_ringHead = 0;
+
+    //Display size indices and the colorized colorbar gradient. They are reused while their sizes stay the same
+    cv::Mat m_displayIndices;
+    cv::Mat m_colorbarGradient;
+
+    //Area of the colormap on the kept canvas, which is colorized again by the updates
+    cv::Rect m_colormapArea;
+
+    Downsampling m_downsampling = Downsampling::None;
 
     cv::ColormapTypes m_colormapType;
 
@@ -0,0 +1,55 @@
+#ifndef COLORMAPKERNEL_H
+#define COLORMAPKERNEL_H
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/imgproc.hpp>
+
+
+//How the colormap is shrunk to the display size. None keeps the display at least as large as the colormap, the others allow smaller displays:
+//Nearest drops the pixels between the displayed ones, Area averages the covered pixels and Max/Min keep the extreme of the covered pixels,
+//so that small features stay visible
+enum class Downsampling{None, Nearest, Area, Max, Min};
+
+class ColormapKernel
+{
+public:
+    //Number of the colors of an OpenCV colormap
+    static constexpr int LOOKUP_TABLE_SIZE = 256;
+
+    /**
+    * @brief Returns the colors of an OpenCV colormap, the color of the index "i" is the color that cv::applyColorMap gives to the value "i"
+    * @param colormapType: The colormap, see ColormapTypes from the OpenCV library
+    * @return 1x256 CV_8UC3 table of the BGR colors
+    */
+    static cv::Mat lookupTable(const cv::ColormapTypes colormapType);
+
+    /**
+    * @brief Clamps the values to [lower, upper], scales them to 0-255 like cv::normalize does and looks their colors up, in a single pass directly into "out".
+    * Nothing is allocated besides "out" and it isn't reallocated if it already has the size of the input and the CV_8UC3 type. Row stripes are colorized
+    * concurrently, values are scaled with SIMD lanes when OpenCV provides them. NaN values get the color of the lower bound
+    * @param input: single channel array, any depth
+    * @param lower: the value that gets the first color
+    * @param upper: the value that gets the last color. If it doesn't exceed the lower bound, every value gets the first color
+    * @param lookupTable: colors of the indices, see lookupTable
+    * @param out: the colorized array
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    */
+    static void colorize(const cv::Mat& input, const double lower, const double upper, const cv::Mat& lookupTable, cv::Mat& out, const int parallelism = 0);
+
+    /**
+    * @brief Scales the values to 0-255 like colorize does, but writes the indices instead of their colors. The CV_8U indices take a third of the memory
+    * of the colors, colorizing them later with the bounds 0 and 255 gives the same colors as colorizing the values
+    */
+    static void quantize(const cv::Mat& input, const double lower, const double upper, cv::Mat& out, const int parallelism = 0);
+
+    /**
+    * @brief Resizes CV_8U indices to the display size. Enlarged indices keep the nearest index, shrunk ones are reduced as the downsampling selects
+    * @param indices: CV_8UC1 indices, see quantize
+    * @param size: the display size
+    * @param downsampling: the reduction of the indices that a display pixel covers
+    * @param out: the resized indices
+    */
+    static void resample(const cv::Mat& indices, const cv::Size& size, const Downsampling downsampling, cv::Mat& out);
+};
+
+#endif // COLORMAPKERNEL_H
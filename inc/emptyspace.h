@@ -8,7 +8,11 @@ class EmptySpace : public PlotElementBase
 public:
     EmptySpace() { canvasSize = cv::Size{ 0, 0 }; };
 
-    cv::Mat generate() { m_canvas = cv::Mat{ canvasSize, CV_8UC3, PainterConstants::white }; return m_canvas; };
+    cv::Mat generate() { if(isCanvasUpToDate(revision())){ return m_canvas; } cv::Mat out; generate(out); m_canvas = out; markRendered(revision()); return out; };
+
+    void generate(cv::Mat& out) { prepareCanvas(out); };
+
+    cv::Size requiredCanvasSize() const { return canvasSize; };
 
     EmptySpace clone() const { return *this; };
 };
@@ -0,0 +1,64 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <opencv2/core/mat.hpp>
+
+
+class GlyphAtlas
+{
+public:
+    //Every character that a numeric axis label can consist of
+    static constexpr std::string_view NUMERIC_GLYPHS = "0123456789+-.e";
+
+    /**
+    * @brief Returns the process wide atlas that the axis labels are rendered with
+    */
+    static GlyphAtlas& instance();
+
+    /**
+    * @brief Checks whether the text only consists of the glyphs that the atlas can render
+    * @param text: text to be checked
+    * @return True if every character of the text is a numeric glyph
+    */
+    static bool canRender(const std::string_view text);
+
+    /**
+    * @brief Renders the text by blitting the pre-rasterized glyphs into a white canvas. Glyphs are rasterized only once per font size, color and font.
+    * The layout matches cv::putText: the pen starts from "margin" and the baseline is located "margin" pixels above the canvas bottom.
+    * @param text: text to be rendered, every character should be a numeric glyph
+    * @param fontSize: font scale of the text
+    * @param color: BGR color of the text
+    * @param font: OpenCV Hershey font face of the text
+    * @param canvasSize: size of the output canvas, glyphs that exceed it are clipped
+    * @param margin: horizontal margin and the distance between the baseline and the canvas bottom
+    * @return The rendered text canvas
+    */
+    cv::Mat renderText(const std::string_view text, const float fontSize, const cv::Scalar& color, const int font, const cv::Size& canvasSize, const int margin);
+
+private:
+    GlyphAtlas() = default;
+
+    struct GlyphSet {
+        std::array<cv::Mat, NUMERIC_GLYPHS.size()> cells;
+        int bleed = 0;
+    };
+
+    using GlyphSetKey = std::tuple<float, int, int, int, double, double, double>;
+
+    static size_t glyphIndex(const char glyph);
+
+    std::shared_ptr<const GlyphSet> glyphSet(const float fontSize, const cv::Scalar& color, const int font, const int canvasHeight, const int margin);
+    static std::shared_ptr<const GlyphSet> rasterizeGlyphSet(const float fontSize, const cv::Scalar& color, const int font, const int canvasHeight, const int margin);
+
+private:
+    std::mutex m_mutex;
+    std::map<GlyphSetKey, std::shared_ptr<const GlyphSet>> m_glyphSets;
+};
+
+#endif // GLYPHATLAS_H
@@ -0,0 +1,64 @@
+#ifndef GRIDLAYOUT_H
+#define GRIDLAYOUT_H
+
+#include <vector>
+#include "opencv2/core/types.hpp"
+
+
+class GridLayout
+{
+public:
+    /**
+    * @brief Constructs an empty grid layout. Every row and column has zero size until the grid is arranged
+    * @param rows: number of rows of the grid
+    * @param cols: number of columns of the grid
+    */
+    GridLayout(const size_t rows, const size_t cols);
+
+    /**
+    * @brief Arranges the grid so that each row is as high as its highest cell and each column is as wide as its widest cell.
+    * Row heights, column widths and their offsets are computed in a single pass over the cells
+    * @param cellSizes: sizes of the cells in row-major order, its size should be equal to rows * cols
+    */
+    void arrange(const std::vector<cv::Size>& cellSizes);
+
+    /**
+    * @brief Arranges the grid with the same size for every cell. Cell sizes aren't needed for this variant
+    * @param cellSize: size of each cell
+    */
+    void arrange(const cv::Size& cellSize);
+
+    size_t rows() const {return m_rowHeights.size();};
+    size_t cols() const {return m_colWidths.size();};
+
+    int rowHeight(const size_t row) const {return m_rowHeights.at(row);};
+    int columnWidth(const size_t col) const {return m_colWidths.at(col);};
+
+    /**
+    * @brief Returns the area of the cell relative to the top left corner of the grid
+    */
+    cv::Rect cellArea(const size_t row, const size_t col) const;
+
+    /**
+    * @brief Row-major index variant of the cellArea function
+    */
+    cv::Rect cellArea(const size_t index) const {return cellArea(index / cols(), index % cols());};
+
+    /**
+    * @brief Returns the total size of the grid
+    */
+    cv::Size size() const {return cv::Size{m_colOffsets.back(), m_rowOffsets.back()};};
+
+private:
+    void updateOffsets();
+
+private:
+    std::vector<int> m_rowHeights;
+    std::vector<int> m_colWidths;
+
+    //Offsets have one more element than the number of rows and columns, the last one is the total size
+    std::vector<int> m_rowOffsets;
+    std::vector<int> m_colOffsets;
+};
+
+#endif // GRIDLAYOUT_H
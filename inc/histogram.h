@@ -2,9 +2,15 @@
 #define HISTOGRAM_H
 
 #include "plotelementbase.h"
+#include "histogrambinning.h"
+#include "histogramstorage.h"
+#include <deque>
 #include <optional>
 
 
+enum class BinAggregation{None, Max, Sum, MinMaxEnvelope};
+enum class SeriesLayout{Overlaid, SideBySide};
+
 class Histogram : public PlotElementBase
 {
 public:
@@ -39,12 +45,115 @@ public:
     * and maximum value within the array
     * @param binStart: first value of the bin range. If it's not given, it will take the minimum value within the array
     * @param binEnd: last value of the bin range. If it's not given, it will take the maximum value within the array
+    * @param sampling: if it's given and the array has more pixels than the samples, only the samples are counted (including the auto-range) and the
+    * counts are scaled up to the size of the array. The histogram is approximate until it's refined
+    */
+    explicit Histogram(const cv::Mat &inArray, const std::optional<int> binSize = {}, const std::optional<float> binStart = {}, const std::optional<float> binEnd = {},
+                       const std::optional<HistogramBinning::Sampling>& sampling = {});
+
+    /**
+    * @brief Creates a histogram with a series per channel. Every channel of the interleaved pixels is counted with a single pass over the array,
+    * without splitting it. The channels share the same bins, the missing range parameters are determined from the extremes of all of the channels
+    * @param inArray: OpenCV array that will be calculated, any depth and number of channels
+    * @param binSize: Number of the bins, see the matrix constructor
+    * @param binStart: first value of the bin range, see the matrix constructor
+    * @param binEnd: last value of the bin range, see the matrix constructor
+    * @return The histogram whose series "i" is the distribution of the channel "i"
+    */
+    static Histogram perChannel(const cv::Mat &inArray, const std::optional<int> binSize = {}, const std::optional<float> binStart = {}, const std::optional<float> binEnd = {});
+
+    /**
+    * @brief Creates a histogram of the selected pixels of the array. The mask, the regions and the weights are applied to the original pixels, nothing is copied.
+    * The missing range parameters are determined from the selected pixels. Sums of the weights are rounded to the nearest count
+    * @param inArray: OpenCV array that will be calculated, any depth, two dimensions
+    * @param selection: the mask, the regions and the weights of the counted pixels, see HistogramBinning::PixelSelection
+    * @param binSize: Number of the bins, see the matrix constructor
+    * @param binStart: first value of the bin range, see the matrix constructor
+    * @param binEnd: last value of the bin range, see the matrix constructor
     */
-    explicit Histogram(const cv::Mat &inArray, const std::optional<int> binSize = {}, const std::optional<float> binStart = {}, const std::optional<float> binEnd = {});
+    static Histogram fromSelection(const cv::Mat &inArray, const HistogramBinning::PixelSelection& selection, const std::optional<int> binSize = {},
+                                   const std::optional<float> binStart = {}, const std::optional<float> binEnd = {});
+
+    /**
+    * @brief Returns a copy of the counts and the bins. The histogram doesn't store them as vectors, so they are returned by value instead of by
+    * reference. The bins are identical to the ones that PlotUtils::linspace computes. Use getCounts and getBinsView to read them without copying
+    */
+    std::vector<size_t> getHistogram() const {return m_histogram.toVector();};
+    std::vector<size_t> getHistogram(const size_t series) const {return getCounts(series).toVector();};
+    std::vector<float> getBins() const {return m_bins.toVector();};
 
     //Getters
-    const std::vector<size_t>& getHistogram() const {return m_histogram;};
-    const std::vector<float>& getBins() const {return m_bins;};
+    const HistogramCounts& getCounts() const {return m_histogram;};
+    const HistogramCounts& getCounts(const size_t series) const;
+    size_t getSeriesCount() const {return 1 + m_additionalSeries.size();};
+    const BinsView& getBinsView() const {return m_bins;};
+    CountWidth getCountWidth() const {return m_histogram.width();};
+    CountWidth getRequestedCountWidth() const {return m_countWidth;};
+    size_t getOutOfRangeCount() const {return m_outOfRangeCount;};
+    size_t getNanCount() const {return m_nanCount;};
+    bool isApproximate() const {return !m_sampledSize.empty();};
+    const std::vector<std::pair<size_t, size_t>>& getConfidenceIntervals() const {return m_confidenceIntervals;};
+
+    /**
+    * @brief Replaces the approximate counts of a sampled histogram with the exact counts of the whole array, the bins are kept.
+    * The histogram doesn't keep the sampled array, so the caller provides it again. Exact histograms are left intact
+    * @param inArray: the array that the histogram has been sampled from. It should have the size of the sampled array
+    */
+    void refine(const cv::Mat& inArray);
+
+    /**
+    * @brief Requests the width of the stored counts. 32-bit counts halve the memory of the counts, they are only used while every count fits into them.
+    * Counts that outgrow them widen the storage to 64 bits, so the counts stay exact. The requested width is kept, counts that are recounted
+    * or reset return to it
+    */
+    void setCountWidth(const CountWidth width);
+
+    /**
+    * @brief Sets how multiple series are drawn: overlaid within the same bars, from the highest to the lowest one, or side by side within each bin.
+    * Aggregated bins are always overlaid
+    */
+    void setSeriesLayout(const SeriesLayout layout);
+
+    /**
+    * @brief Sets how the bins are drawn if there are more bins than pixel columns. With None, the canvas grows to at least one pixel column per bin.
+    * Other modes keep the minimum canvas width independent of the number of bins and draw each pixel column from the bins that fall into it:
+    * the largest count (Max), the total count (Sum), or the range between the smallest and the largest count (MinMaxEnvelope)
+    */
+    void setBinAggregation(const BinAggregation aggregation);
+
+    /**
+    * @brief Adds the first channel of the frame to the counts. The bins are fixed, values are mapped uniformly over the range that the histogram
+    * has been built with: from the start to the exclusive end of the bin range, or one unit per bin from 1 if only the counts have been given.
+    * Values outside of the range are tallied as rejected. Histograms with explicitly given bins cannot accumulate frames, since their bins
+    * aren't necessarily uniform. The cost depends only on the frame and the number of bins
+    * @param frame: OpenCV array that will be counted, any depth
+    */
+    void accumulate(const cv::Mat& frame);
+
+    /**
+    * @brief Removes the counts of a previously accumulated frame. Not available while the histogram forgets its frames by a window or a decay
+    * @param frame: OpenCV array that will be removed from the counts, any depth
+    */
+    void subtract(const cv::Mat& frame);
+
+    /**
+    * @brief Keeps only the last accumulated frames, the oldest frame is subtracted once the window is full. Counts that have been accumulated before
+    * the window is enabled are kept permanently
+    * @param frames: number of the frames within the window. 0 disables the window and keeps every frame
+    */
+    void setSlidingWindow(const size_t frames);
+
+    /**
+    * @brief Enables exponential forgetting: the counts, including the rejected tallies, are scaled by the factor before every accumulated frame is added.
+    * Decayed counts are kept in double precision, the histogram presents them rounded
+    * @param factor: weight of the previous counts, between 0 and 1. 1 disables the decay and keeps every frame
+    */
+    void setDecayFactor(const double factor);
+
+    /**
+    * @brief Sets every count of every series and every rejected tally to zero and forgets the frames of the window, the bins are kept
+    */
+    void resetCounts();
 
     Histogram clone() const;
 
@@ -54,16 +163,77 @@ public:
     */
     cv::Mat generate();
 
+    /**
+    * @brief Generates the histogram canvas directly into the given buffer. If "out" already has the size of the canvas and the CV_8UC3 type,
+    * its buffer is reused (this also holds for a submatrix of a larger canvas). Once the texts are cached, repeated calls don't allocate.
+    * The buffer stays the caller's, it is drawn on every call and isn't kept by the element.
+    * @param out: the buffer that the canvas will be drawn into
+    */
+    void generate(cv::Mat& out);
+
+    /**
+    * @brief Calculates the size of the canvas that generate will produce, without rendering anything
+    */
+    cv::Size requiredCanvasSize();
+
 private:
+    //Counts of a single accumulated frame
+    struct FrameCounts
+    {
+        std::vector<size_t> counts;
+        size_t outOfRangeCount = 0;
+        size_t nanCount = 0;
+    };
+
+    void countArray(const cv::Mat& inArray, const std::optional<int> binSize, const std::optional<float> binStart, const std::optional<float> binEnd);
+
+    FrameCounts countFrame(const cv::Mat& frame) const;
+
+    void removeFrame(const FrameCounts& frameCounts);
+
     cv::Size calculateMinimumCanvasSize(const cv::Size& titleCanvasSize, const cv::Size& xAxisCanvasSize);
 
-    cv::Mat generateHistogramCanvas(const int titleCanvasHeight, const int xAxisCanvasHeight);
+    void drawHistogramCanvas(cv::Mat& out) const;
+
+    void drawAggregatedHistogramCanvas(cv::Mat& out) const;
+
+    const HistogramCounts& seriesCounts(const size_t series) const;
+
+    cv::Scalar seriesColor(const size_t series) const;
 
     int totalHeightPadding() const;
 
 private:
-    std::vector<size_t> m_histogram;
-    std::vector<float> m_bins;
+    //Bins that are uniformly spaced are stored by their range, the values of other bins are shared between the copies
+    HistogramCounts m_histogram;
+    BinsView m_bins;
+    BinAggregation m_binAggregation = BinAggregation::None;
+
+    //Width that the counts are stored with while they fit into it, see setCountWidth
+    CountWidth m_countWidth = CountWidth::Bits64;
+
+    //Series of the channels after the first one, the first series is m_histogram
+    std::vector<HistogramCounts> m_additionalSeries;
+    SeriesLayout m_seriesLayout = SeriesLayout::Overlaid;
+
+    //Range that the values are mapped over by the streaming functions. Histograms with explicitly given bins don't have it
+    std::optional<HistogramBinning::BinRange> m_binRange;
+
+    //Values of the array that haven't been counted into any bin
+    size_t m_outOfRangeCount = 0;
+    size_t m_nanCount = 0;
+
+    //Approximate histograms keep the size of their array and the 95% confidence interval of each bin, until they are refined
+    cv::Size m_sampledSize;
+    std::vector<std::pair<size_t, size_t>> m_confidenceIntervals;
+
+    //Streaming members. The frames of the window are kept to be subtracted, decayed counts are kept in double precision
+    size_t m_windowLength = 0;
+    std::deque<FrameCounts> m_windowFrames;
+    double m_decayFactor = 1.0;
+    std::vector<double> m_decayedCounts;
+    double m_decayedOutOfRangeCount = 0;
+    double m_decayedNanCount = 0;
 
 };
 
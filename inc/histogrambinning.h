@@ -0,0 +1,201 @@
+#ifndef HISTOGRAMBINNING_H
+#define HISTOGRAMBINNING_H
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <opencv2/core/mat.hpp>
+
+
+class HistogramBinning
+{
+public:
+    //Number of the values that haven't been counted into any bin
+    struct RejectedValues
+    {
+        size_t outOfRange = 0;
+        size_t nan = 0;
+    };
+
+    enum class SamplingMethod {Strided, Random, Block};
+
+    //Selects a subset of the pixels, so that the cost of counting depends on the number of samples instead of the size of the array
+    struct Sampling
+    {
+        SamplingMethod method = SamplingMethod::Strided;
+        size_t sampleCount = size_t{1} << 18;
+        uint64_t seed = 0;
+    };
+
+    //Restricts and weights the counted pixels of an array without copying them. Empty members don't restrict anything
+    struct PixelSelection
+    {
+        //CV_8UC1 array of the size of the input, only the pixels with a non-zero mask value are counted
+        cv::Mat mask;
+        //Rectangles within the input, only the pixels inside them are counted. A pixel is counted once per rectangle that contains it
+        std::vector<cv::Rect> regions;
+        //CV_32FC1 array of the size of the input, each counted pixel adds its weight to its bin instead of one
+        cv::Mat weights;
+    };
+
+    //Uniformly spaced bins between the inclusive start and the exclusive end
+    struct BinRange
+    {
+        size_t binCount = 0;
+        float binStart = 0;
+        float binEnd = 0;
+    };
+
+    /**
+    * @brief Finds the minimum and maximum values of the array, considering every channel (same as cv::minMaxLoc). NaN values are ignored.
+    * Row stripes are processed concurrently and their partial results are merged
+    * @param input: the array to be searched, any depth and number of channels
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    * @return The minimum and maximum values of the array
+    */
+    static std::pair<double, double> minMax(const cv::Mat& input, const int parallelism = 0);
+
+    /**
+    * @brief Extends the extremes by the values of the array, see minMax. The extremes stay intact if the array has no comparable values,
+    * so the extremes of data which is processed part by part can be found. Start with {+infinity, -infinity}
+    * @param input: the array to be searched, any depth and number of channels
+    * @param extremes: the minimum and maximum values that will be extended
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    */
+    static void extendMinMax(const cv::Mat& input, std::pair<double, double>& extremes, const int parallelism = 0);
+
+    /**
+    * @brief Finds the minimum and maximum values of the selected pixels, considering every channel. See minMax, weights are ignored
+    */
+    static std::pair<double, double> minMax(const cv::Mat& input, const PixelSelection& selection, const int parallelism = 0);
+
+    /**
+    * @brief Counts the values of the first channel into uniformly spaced bins. Each thread fills private bins over its own row stripe,
+    * partial counts are merged at the end. Values are mapped with exactly the same arithmetic as cv::calcHist for uniform ranges,
+    * so only the count type differs: counts are exact for any number of values. Unlike cv::calcHist, NaN values aren't counted into the first bin.
+    * Bin indices of single channel CV_32F and CV_64F arrays are computed with SIMD lanes when OpenCV provides them
+    * @param input: the array to be counted, any depth
+    * @param binCount: number of the bins
+    * @param binStart: inclusive lower boundary of the first bin
+    * @param binEnd: exclusive upper boundary of the last bin
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    * @param rejected: if it's given, the values outside of the range and the NaN values are added to it
+    * @return Count of each bin
+    */
+    static std::vector<size_t> countBins(const cv::Mat& input, const size_t binCount, const float binStart, const float binEnd, const int parallelism = 0, RejectedValues* rejected = nullptr);
+
+    /**
+    * @brief Adds the bin counts of the array to "counts", see countBins. The number of bins is the size of "counts"
+    * @param input: the array to be counted, any depth
+    * @param binStart: inclusive lower boundary of the first bin
+    * @param binEnd: exclusive upper boundary of the last bin
+    * @param counts: the counts that the bin counts of the array will be added to
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    * @param rejected: if it's given, the values outside of the range and the NaN values are added to it
+    */
+    static void accumulateCounts(const cv::Mat& input, const float binStart, const float binEnd, std::vector<size_t>& counts, const int parallelism = 0, RejectedValues* rejected = nullptr);
+
+    /**
+    * @brief Counts the values of the first channel of the selected pixels into uniformly spaced bins, see countBins. The mask and the regions are applied
+    * to the original pixels: each region is a view of the array and the runs of masked pixels are counted like contiguous spans, so neither stripes nor
+    * vector lanes are lost to the selection
+    * @param input: the array to be counted, any depth, two dimensions
+    * @param selection: the mask and the regions of the counted pixels. Weighted pixels are counted by countWeightedBins
+    * @param binCount: number of the bins
+    * @param binStart: inclusive lower boundary of the first bin
+    * @param binEnd: exclusive upper boundary of the last bin
+    * @param parallelism: maximum number of threads of each region. 0 lets OpenCV decide, 1 processes the regions serially
+    * @param rejected: if it's given, the selected values outside of the range and the selected NaN values are added to it
+    * @return Count of each bin
+    */
+    static std::vector<size_t> countBins(const cv::Mat& input, const PixelSelection& selection, const size_t binCount, const float binStart, const float binEnd,
+                                         const int parallelism = 0, RejectedValues* rejected = nullptr);
+
+    /**
+    * @brief Sums the weights of the selected pixels into uniformly spaced bins, see countBins with a selection. Rejected values are counted by pixels
+    * @param selection: the mask, the regions and the weights of the counted pixels. The weights are required
+    * @return Sum of the weights of each bin
+    */
+    static std::vector<double> countWeightedBins(const cv::Mat& input, const PixelSelection& selection, const size_t binCount, const float binStart, const float binEnd,
+                                                 const int parallelism = 0, RejectedValues* rejected = nullptr);
+
+    /**
+    * @brief Counts the values of every channel into uniformly spaced bins with a single pass over the interleaved pixels, see countBins
+    * @param input: the array to be counted, any depth and number of channels
+    * @param binCount: number of the bins of each channel
+    * @param binStart: inclusive lower boundary of the first bin
+    * @param binEnd: exclusive upper boundary of the last bin
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    * @param rejected: if it's given, the values of every channel outside of the range and the NaN values are added to it
+    * @return Count of each bin, per channel
+    */
+    static std::vector<std::vector<size_t>> countChannels(const cv::Mat& input, const size_t binCount, const float binStart, const float binEnd, const int parallelism = 0,
+                                                          RejectedValues* rejected = nullptr);
+
+    /**
+    * @brief Checks whether the array can be counted by its values (8-bit and 16-bit unsigned arrays)
+    */
+    static bool supportsValueCounts(const cv::Mat& input);
+
+    /**
+    * @brief Counts how many times each possible value occurs in the first channel of an 8-bit or 16-bit unsigned array. The table has 256 or 65536 entries.
+    * Every stripe counts into interleaved 32-bit sub-tables which are periodically moved into the exact counters, so counts are exact for any array size
+    * @param input: the array to be counted, CV_8U or CV_16U
+    * @param parallelism: maximum number of threads. 0 lets OpenCV decide, 1 processes the array serially
+    * @return The count of each value, indexed by the value
+    */
+    static std::vector<size_t> valueCounts(const cv::Mat& input, const int parallelism = 0);
+
+    /**
+    * @brief Finds the smallest and the largest value that occur in a value count table, see valueCounts
+    */
+    static std::pair<double, double> minMax(const std::vector<size_t>& valueCounts);
+
+    /**
+    * @brief Folds a value count table into uniformly spaced bins. The result is identical to countBins over the array that the table has been counted from
+    * @param valueCounts: the count of each value, indexed by the value
+    * @param binCount: number of the bins
+    * @param binStart: inclusive lower boundary of the first bin
+    * @param binEnd: exclusive upper boundary of the last bin
+    * @param rejected: if it's given, the values outside of the range are added to it
+    * @return Count of each bin
+    */
+    static std::vector<size_t> foldValueCounts(const std::vector<size_t>& valueCounts, const size_t binCount, const float binStart, const float binEnd, RejectedValues* rejected = nullptr);
+
+    /**
+    * @brief Copies a subset of the pixels into a single row array of the same type. Strided sampling takes evenly spaced pixels, random sampling takes
+    * uniformly distributed pixels and block sampling takes runs of adjacent pixels at random positions, which is the most cache friendly one
+    * @param input: the array to be sampled, any depth and number of channels
+    * @param sampling: method and number of the samples. If the array doesn't have more pixels than the samples, the array itself is returned
+    * @return The sampled pixels
+    */
+    static cv::Mat sample(const cv::Mat& input, const Sampling& sampling);
+
+    /**
+    * @brief Estimates the 95% confidence interval of the count of each bin from the counts of a sample (Wilson score interval)
+    * @param sampleCounts: bin counts of the sample
+    * @param sampleCount: number of the samples, including the ones that haven't been counted into any bin
+    * @param totalCount: number of the values that the sample has been taken from
+    * @return Lower and upper bound of the count of each bin, in the scale of the total count
+    */
+    static std::vector<std::pair<size_t, size_t>> confidenceIntervals(const std::vector<size_t>& sampleCounts, const size_t sampleCount, const size_t totalCount);
+
+    /**
+    * @brief Completes the bin parameters that aren't given, the same way for every histogram source. A missing boundary is the extreme of the data
+    * extended by 5% padding, a missing number of bins gives one bin per unit of the range
+    * @param extremes: minimum and maximum values of the data, only used for the missing boundaries
+    * @param binCount: number of the bins
+    * @param binStart: inclusive lower boundary of the first bin
+    * @param binEnd: exclusive upper boundary of the last bin
+    * @return The complete bin parameters
+    */
+    static BinRange resolveBinRange(const std::pair<double, double>& extremes, const std::optional<int> binCount, const std::optional<float> binStart, const std::optional<float> binEnd);
+
+    /**
+    * @brief Returns the number of row stripes that an array with the given number of values is split into
+    */
+    static int stripeCount(const size_t totalValues, const int parallelism);
+};
+
+#endif // HISTOGRAMBINNING_H
@@ -0,0 +1,174 @@
+#ifndef HISTOGRAMSTORAGE_H
+#define HISTOGRAMSTORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <variant>
+#include <vector>
+
+
+//Random access iterator over a container whose elements are converted or computed on access, so the iterator yields values instead of references
+template<typename Container, typename Value>
+class IndexIterator
+{
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Value;
+
+    IndexIterator() = default;
+    IndexIterator(const Container* container, const size_t index) : m_container(container), m_index(index) {}
+
+    Value operator*() const {return (*m_container)[m_index];};
+    Value operator[](const difference_type offset) const {return (*m_container)[m_index + offset];};
+
+    IndexIterator& operator++() {m_index++; return *this;};
+    IndexIterator& operator--() {m_index--; return *this;};
+    IndexIterator operator++(int) {IndexIterator previous = *this; m_index++; return previous;};
+    IndexIterator operator--(int) {IndexIterator previous = *this; m_index--; return previous;};
+    IndexIterator& operator+=(const difference_type offset) {m_index += offset; return *this;};
+    IndexIterator& operator-=(const difference_type offset) {m_index -= offset; return *this;};
+    IndexIterator operator+(const difference_type offset) const {return IndexIterator(m_container, m_index + offset);};
+    IndexIterator operator-(const difference_type offset) const {return IndexIterator(m_container, m_index - offset);};
+    friend IndexIterator operator+(const difference_type offset, const IndexIterator& iterator) {return iterator + offset;};
+    difference_type operator-(const IndexIterator& other) const {return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);};
+
+    bool operator==(const IndexIterator& other) const {return m_index == other.m_index;};
+    bool operator!=(const IndexIterator& other) const {return m_index != other.m_index;};
+    bool operator<(const IndexIterator& other) const {return m_index < other.m_index;};
+    bool operator>(const IndexIterator& other) const {return m_index > other.m_index;};
+    bool operator<=(const IndexIterator& other) const {return m_index <= other.m_index;};
+    bool operator>=(const IndexIterator& other) const {return m_index >= other.m_index;};
+
+private:
+    const Container* m_container = nullptr;
+    size_t m_index = 0;
+};
+
+enum class CountWidth{Bits32, Bits64};
+
+class HistogramCounts
+{
+public:
+    using const_iterator = IndexIterator<HistogramCounts, size_t>;
+    using iterator = const_iterator;
+    using value_type = size_t;
+
+    HistogramCounts() = default;
+
+    /**
+    * @brief Stores the counts with the given width. Narrow storage is only used if every count fits into it, counts that outgrow it
+    * widen the storage to 64 bits, so the counts are always exact
+    */
+    explicit HistogramCounts(const std::vector<size_t>& counts, const CountWidth width = CountWidth::Bits64);
+    explicit HistogramCounts(std::vector<size_t>&& counts, const CountWidth width = CountWidth::Bits64);
+
+    size_t size() const;
+    bool empty() const {return size() == 0;};
+    size_t operator[](const size_t index) const;
+    size_t max() const;
+
+    const_iterator begin() const {return const_iterator(this, 0);};
+    const_iterator end() const {return const_iterator(this, size());};
+    const_iterator cbegin() const {return begin();};
+    const_iterator cend() const {return end();};
+
+    /**
+    * @brief Returns the width of the storage, which can be wider than the requested one
+    */
+    CountWidth width() const {return (std::holds_alternative<std::vector<uint32_t>>(m_counts))? CountWidth::Bits32 : CountWidth::Bits64;};
+
+    /**
+    * @brief Requests the width of the storage. 32-bit storage is only used if every count fits into it
+    */
+    void setWidth(const CountWidth width);
+
+    /**
+    * @brief Returns the number of bytes that the counts occupy
+    */
+    size_t bytes() const {return size() * ((width() == CountWidth::Bits32)? sizeof(uint32_t) : sizeof(uint64_t));};
+
+    /**
+    * @brief Returns the counts for updating them in place, which is possible while they are stored as 64-bit size_t values. Returns null otherwise
+    */
+    std::vector<size_t>* wideCounts();
+
+    void set(const size_t index, const size_t count);
+    void fill(const size_t count);
+
+    /**
+    * @brief Adds or subtracts the counts element-wise. The number of the counts should match, subtracted counts shouldn't exceed the stored ones
+    */
+    void add(const std::vector<size_t>& counts);
+    void subtract(const std::vector<size_t>& counts);
+
+    std::vector<size_t> toVector() const;
+    operator std::vector<size_t>() const {return toVector();};
+
+private:
+    void widen();
+
+private:
+    std::variant<std::vector<uint64_t>, std::vector<uint32_t>> m_counts;
+};
+
+bool operator==(const HistogramCounts& lhs, const HistogramCounts& rhs);
+bool operator==(const HistogramCounts& lhs, const std::vector<size_t>& rhs);
+bool operator==(const std::vector<size_t>& lhs, const HistogramCounts& rhs);
+
+class BinsView
+{
+public:
+    using const_iterator = IndexIterator<BinsView, float>;
+    using iterator = const_iterator;
+    using value_type = float;
+
+    BinsView() = default;
+
+    /**
+    * @brief Uniformly spaced bins, which are computed on access. Both ends are included like PlotUtils::linspace does. Single bins are computed
+    * directly, so they can differ from the accumulated PlotUtils::linspace values in the last bit. toVector produces the identical values
+    * @param start: value of the first bin
+    * @param end: value of the last bin
+    * @param count: number of the bins
+    */
+    explicit BinsView(const float start, const float end, const size_t count);
+
+    /**
+    * @brief Bins with arbitrary values. The values are shared by the copies of the view
+    */
+    explicit BinsView(std::vector<float>&& bins);
+    explicit BinsView(const std::vector<float>& bins) : BinsView(std::vector<float>(bins)) {};
+
+    size_t size() const {return (m_values)? m_values->size() : m_count;};
+    bool empty() const {return size() == 0;};
+    bool isUniform() const {return !m_values;};
+    float operator[](const size_t index) const;
+    float front() const {return (*this)[0];};
+    float back() const {return (*this)[size() - 1];};
+
+    const_iterator begin() const {return const_iterator(this, 0);};
+    const_iterator end() const {return const_iterator(this, size());};
+    const_iterator cbegin() const {return begin();};
+    const_iterator cend() const {return end();};
+
+    std::vector<float> toVector() const;
+    operator std::vector<float>() const {return toVector();};
+
+private:
+    float m_start = 0;
+    float m_end = 0;
+    size_t m_count = 0;
+    double m_step = 0;
+    std::shared_ptr<const std::vector<float>> m_values;
+};
+
+bool operator==(const BinsView& lhs, const BinsView& rhs);
+bool operator==(const BinsView& lhs, const std::vector<float>& rhs);
+bool operator==(const std::vector<float>& lhs, const BinsView& rhs);
+
+#endif // HISTOGRAMSTORAGE_H
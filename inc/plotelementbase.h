@@ -12,6 +12,7 @@
 namespace PainterConstants{
 inline const cv::Scalar white{255, 255, 255};
 inline const cv::Scalar black{0, 0, 0};
+inline const cv::Scalar gray{160, 160, 160};
 inline const cv::Scalar blue{255, 0, 0};
 inline const cv::Scalar green{0, 255, 0};
 inline const cv::Scalar red{0, 0, 255};
@@ -46,13 +47,13 @@ public:
     * @param width: Width of the target canvas
     * @param height: Height of the target canvas
     */
-    void setCanvasSize(const uint16_t width, const uint16_t height){ canvasSize.height = height; canvasSize.width = width;}
+    void setCanvasSize(const uint16_t width, const uint16_t height){ setCanvasSize(cv::Size{width, height}); }
 
     /**
     * @brief cv::Size variant of the setcanvasSize function
     * @param size: shape of the canvas
     */
-    void setCanvasSize(const cv::Size size) {canvasSize = size;};
+    void setCanvasSize(const cv::Size size) { if(canvasSize != size){ canvasSize = size; markModified(); } };
 
     /**
     * @brief Sets the text field that has been provided from the parameter "component"
@@ -73,20 +74,74 @@ public:
 
     bool empty() const {return m_canvas.empty();};
 
+    /**
+    * @brief Returns the revision of the element. Every modification assigns a new revision which is larger than all of the previously assigned ones
+    * (process wide), so the revisions of different elements can be compared as well. Copies and assignments take a new revision as well
+    */
+    uint64_t revision() const {return m_revision.value;};
+
 protected:
+    //Subplot renders its elements with the sizes of their cells without modifying them
+    friend class Subplot;
+
     //The base class should never be constructed induvidually
     PlotElementBase() = default;
 
+    /**
+    * @brief Assigns a new revision to the element. Should be called by every function that changes the content of the canvas
+    */
+    void markModified() {m_revision.value = nextRevision();};
+
+    /**
+    * @brief Records that the canvas has been drawn for the given revision and the current canvas size. Only canvases that the element has
+    * allocated itself are recorded, never the buffers of the callers
+    */
+    void markRendered(const uint64_t renderedRevision) {m_renderedRevision = renderedRevision; m_renderedSize = canvasSize;};
+
+    /**
+    * @brief Checks whether the canvas has already been drawn for the given revision and the current canvas size
+    */
+    bool isCanvasUpToDate(const uint64_t currentRevision) const;
+
+    static uint64_t nextRevision();
+
     [[nodiscard]] static cv::Mat generateText(const float_t fontSize, const std::string_view text, const cv::Scalar textColor=PainterConstants::black);
 
     [[nodiscard]] static cv::Mat generateNumericText(const float_t fontSize, const double_t number, const uint8_t precision);
 
     [[nodiscard]] static cv::Size allocateNumericTextSpace(const float_t fontSize, const double_t number, const uint8_t precision);
 
+    /**
+    * @brief Calculates the size of the canvas that generateText produces for the given text, without rasterizing anything
+    * @param fontSize: font scale of the text
+    * @param text: the text to be measured
+    * @return Size of the text canvas
+    */
+    [[nodiscard]] static cv::Size measureText(const float_t fontSize, const std::string_view text);
+
     enum class AlignmentType{WidthOnly, HeightOnly, WholeShape};
     static void centerElement(cv::Mat& centerTarget, const cv::Size& centerArea, const AlignmentType alignmentType);
     [[nodiscard]] static cv::Mat centerElement(const cv::Mat& centerTarget, const cv::Size& centerArea, const AlignmentType alignmentType);
 
+    /**
+    * @brief Copies the element into the given area of the target, centered along the axes that the alignment type specifies. Nothing is allocated
+    * @param element: element to be placed
+    * @param target: canvas that the element will be copied into
+    * @param area: area of the target that the element will be centered within. Only the origin is used for the axes that aren't aligned
+    * @param alignmentType: axes that the element will be centered along
+    */
+    static void placeElement(const cv::Mat& element, cv::Mat& target, const cv::Rect& area, const AlignmentType alignmentType);
+
+    /**
+    * @brief Paints the whole 8UC3 area with the given color without allocating a temporary
+    */
+    static void fillArea(cv::Mat& area, const cv::Scalar& color);
+
+    /**
+    * @brief Shapes "out" as a blank canvas with the size of the element. Buffer of "out" is reused if it already has the right size and type
+    */
+    void prepareCanvas(cv::Mat& out) const;
+
     void addAxis(cv::Mat& plotElement, const OffsetRange offset_x, const OffsetRange offset_y, const AxisRange range_x, const AxisRange range_y) const;
 
     //protected getters
@@ -120,6 +175,20 @@ protected:
     cv::Size m_xAxisTextSize{};
     cv::Size m_yAxisTextSize{};
 
+    //Revision that copies and assignments renew, so an element that replaces another one is never taken for an older render of it
+    struct Revision
+    {
+        Revision() = default;
+        Revision(const Revision&) {}
+        Revision& operator=(const Revision&) {value = nextRevision(); return *this;}
+
+        uint64_t value = nextRevision();
+    };
+
+    //Change tracking members, the canvas is only drawn again if the revision or the size differs from the rendered ones
+    Revision m_revision;
+    uint64_t m_renderedRevision = 0;
+    cv::Size m_renderedSize{};
 
 };
 
@@ -0,0 +1,86 @@
+#ifndef RAWIMAGESOURCE_H
+#define RAWIMAGESOURCE_H
+
+#include "histogram.h"
+#include "histogrambinning.h"
+#include <functional>
+#include <optional>
+#include <string>
+
+
+class RawImageSource
+{
+public:
+    enum class AccessMode {MemoryMap, Stream};
+
+    /**
+    * @brief Describes an image that is stored as raw pixels in a file. The file is only read by the functions that process it, chunk by chunk,
+    * so the image is never loaded as a whole
+    * @param path: path of the raw file
+    * @param type: OpenCV type of the pixels, such as CV_16UC1
+    * @param size: width and height of the image in pixels
+    * @param stride: number of bytes between the beginnings of two consecutive rows. 0 means that the rows are packed
+    * @param offset: number of bytes before the first row, such as a file header
+    * @param mode: MemoryMap maps each chunk of the file, Stream reads each chunk into a reused buffer. Memory mapping falls back to streaming on
+    * platforms without POSIX mmap
+    */
+    explicit RawImageSource(const std::string& path, const int type, const cv::Size& size, const size_t stride = 0, const size_t offset = 0,
+                            const AccessMode mode = AccessMode::MemoryMap);
+
+    /**
+    * @brief Sets the maximum number of bytes that are processed at once. At least one row is processed at once regardless of the limit
+    */
+    void setChunkSize(const size_t bytes);
+
+    /**
+    * @brief Sets the maximum number of threads that process each chunk. 0 lets OpenCV decide, 1 processes the chunks serially
+    */
+    void setParallelism(const int parallelism);
+
+    /**
+    * @brief Finds the minimum and maximum values of the image, considering every channel. See HistogramBinning::minMax
+    */
+    std::pair<double, double> minMax() const;
+
+    /**
+    * @brief Counts the values of the first channel into uniformly spaced bins. See HistogramBinning::countBins
+    */
+    std::vector<size_t> countBins(const size_t binCount, const float binStart, const float binEnd, HistogramBinning::RejectedValues* rejected = nullptr) const;
+
+    /**
+    * @brief Creates the histogram of the image with the same parameters as the matrix constructor of Histogram. If a boundary isn't given, the extremes
+    * are found by a first pass over the file and the values are counted by a second one. 8-bit and 16-bit unsigned single channel images are counted
+    * by their values, which requires a single pass
+    */
+    Histogram createHistogram(const std::optional<int> binSize = {}, const std::optional<float> binStart = {}, const std::optional<float> binEnd = {}) const;
+
+    //Getters
+    const std::string& getPath() const {return m_path;};
+    cv::Size getSize() const {return m_size;};
+    int getType() const {return m_type;};
+
+private:
+    /**
+    * @brief Calls the functor with consecutive chunks of rows. A chunk is only valid within the call
+    */
+    void forEachChunk(const std::function<void(const cv::Mat&)>& functor) const;
+
+    void mapChunks(const std::function<void(const cv::Mat&)>& functor) const;
+
+    void streamChunks(const std::function<void(const cv::Mat&)>& functor) const;
+
+    int chunkRows() const;
+
+private:
+    std::string m_path;
+    int m_type;
+    cv::Size m_size;
+    size_t m_stride;
+    size_t m_offset;
+    AccessMode m_mode;
+
+    size_t m_chunkSize;
+    int m_parallelism = 0;
+};
+
+#endif // RAWIMAGESOURCE_H
@@ -4,16 +4,72 @@
 #include "histogram.h"
 #include "colormap.h"
 #include "emptyspace.h"
+#include "gridlayout.h"
+#include <memory>
+#include <optional>
 
 
 class Subplot : public PlotElementBase
 {
 public:
+    /**
+    * @brief Constructs a subplot from the copies of the plot elements. Elements are placed row by row
+    * @param plotElements: elements to be placed, its size should be equal to rows * cols
+    * @param rows: number of rows of the grid
+    * @param cols: number of columns of the grid
+    */
     Subplot(const std::vector<Plottable>& plotElements, const size_t rows, const size_t cols);
 
+    /**
+    * @brief Move variant of the constructor, element data is moved into the subplot without being copied
+    */
+    Subplot(std::vector<Plottable>&& plotElements, const size_t rows, const size_t cols);
+
+    /**
+    * @brief Constructs a subplot that shares the ownership of the plot elements. Modifying an element through its handle
+    * invalidates the subplot canvas, so the next generate call reflects the change. The same handle can be placed into multiple cells.
+    * Copies of the subplot share the elements as well, use clone to get independent elements
+    */
+    Subplot(std::vector<std::shared_ptr<Plottable>> plotElements, const size_t rows, const size_t cols);
+
     cv::Mat generate();
 
-    const Plottable& operator[](size_t index) const {return m_plotElements[index];};
+    /**
+    * @brief Generates the subplot canvas directly into the given buffer. Every plot element is rendered on its own area of "out",
+    * so no intermediate per-element canvas is copied. The buffer stays the caller's, it is drawn on every call and isn't kept by the subplot
+    * @param out: the buffer that the canvas will be drawn into
+    */
+    void generate(cv::Mat& out);
+
+    /**
+    * @brief Calculates the size of the canvas that generate will produce, without rendering any of the elements
+    */
+    cv::Size requiredCanvasSize();
+
+    /**
+    * @brief Returns the latest revision among the subplot and its elements, so that modifying any element invalidates the subplot canvas
+    */
+    uint64_t revision() const;
+
+    /**
+    * @brief Gives every cell the same size, so the elements don't need to be measured to arrange the grid. Elements that require
+    * a larger canvas than the cell size cause generate to throw
+    * @param cellSize: size of each cell. If it's nullopted, each row and column fits its largest element (default)
+    */
+    void setCellSize(const std::optional<cv::Size> cellSize);
+
+    /**
+    * @brief Caps the number of threads that render the plot elements concurrently. The output doesn't depend on this setting
+    * @param maxThreads: maximum number of threads. 0 lets OpenCV decide (see cv::setNumThreads), 1 renders the elements serially
+    */
+    void setParallelism(const int maxThreads);
+
+    const Plottable& operator[](size_t index) const {return *m_plotElements[index];};
+
+    /**
+    * @brief Returns the shared handle of the element at the given index
+    */
+    const std::shared_ptr<Plottable>& element(size_t index) const {return m_plotElements.at(index);};
 
     //Precision won't be involved for this class
     void setPrecision(const AxisType axisType, const uint8_t precision) = delete;
@@ -22,12 +78,18 @@ public:
 private:
     size_t m_rows;
     size_t m_cols;
-    std::vector<Plottable> m_plotElements;
+    std::vector<std::shared_ptr<Plottable>> m_plotElements;
+    int m_parallelism = 0;
+    std::optional<cv::Size> m_fixedCellSize;
 
 private:
     cv::Size calculateMinimumCanvasSize(const cv::Size& titleCanvasSize, const int totalRowHeight, const int totalColWidth) const;
-    std::vector<int> getLargestRows() const;
-    std::vector<int> getLargestColumns() const;
+    void validateElements();
+    void collectElements(std::vector<const Plottable*>& elements) const;
+    bool hasRepeatedElements() const;
+    std::vector<cv::Size> requiredElementSizes();
+    GridLayout arrangeGrid();
+    static void renderElementInto(Plottable& element, const cv::Size& cellSize, cv::Mat& target);
 };
 
 #endif // SUBPLOT_H
@@ -0,0 +1,41 @@
+#ifndef TEXTMETRICS_H
+#define TEXTMETRICS_H
+
+#include <array>
+#include <string_view>
+#include "opencv2/core/types.hpp"
+
+
+class TextMetrics
+{
+public:
+    //Hershey fonts cover the printable ASCII range
+    static constexpr int FIRST_GLYPH = ' ';
+    static constexpr int LAST_GLYPH = '~';
+
+    struct FontMetrics {
+        std::array<int, LAST_GLYPH - FIRST_GLYPH + 1> advanceUnits{};
+        int heightUnits = 0;
+        int baselineUnits = 0;
+    };
+
+    /**
+    * @brief Returns the advance widths and the vertical metrics of the given font in font units. Metrics are measured once per font and then cached
+    * @param font: OpenCV Hershey font face
+    * @return Metrics table of the font
+    */
+    static const FontMetrics& fontMetrics(const int font);
+
+    /**
+    * @brief Measures the text without rasterizing it. The result is identical to cv::getTextSize
+    * @param text: text to be measured
+    * @param fontScale: font scale of the text
+    * @param font: OpenCV Hershey font face
+    * @param thickness: stroke thickness of the text
+    * @param baseline: optional output, y-coordinate of the baseline relative to the bottom-most text point
+    * @return The size of the box that contains the text
+    */
+    static cv::Size textSize(const std::string_view text, const double fontScale, const int font, const int thickness, int* baseline = nullptr);
+};
+
+#endif // TEXTMETRICS_H
@@ -0,0 +1,108 @@
+#ifndef TEXTRASTERCACHE_H
+#define TEXTRASTERCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <opencv2/core/mat.hpp>
+
+
+class TextRasterCache
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 512;
+
+    /**
+    * @brief Returns the process wide cache that every plot element renders its texts through
+    */
+    static TextRasterCache& instance();
+
+    /**
+    * @brief Returns the canvas that has been rendered for the given key. If the key hasn't been rendered before, "render" is invoked and its result is stored.
+    * The returned matrix shares its buffer with the cache entry, hence it should be treated as read-only.
+    * @param text: the text that has been rendered
+    * @param fontSize: font scale of the text
+    * @param color: BGR color of the text
+    * @param font: OpenCV font face of the text
+    * @param render: functor that takes no parameters and returns the rendered cv::Mat canvas
+    * @return The rendered text canvas
+    */
+    template<typename Renderer>
+    cv::Mat getOrRender(const std::string_view text, const float fontSize, const cv::Scalar& color, const int font, const Renderer& render)
+    {
+        const Key key{text, fontSize, color, font};
+
+        cv::Mat cached;
+        if(find(key, cached))
+            return cached;
+
+        //Render outside of the lock, concurrent misses on the same key are resolved while inserting
+        cv::Mat rendered = render();
+        insert(key, rendered);
+        return rendered;
+    }
+
+    /**
+    * @brief Sets the maximum number of the text canvases to be stored. Least recently used entries are evicted first.
+    * @param capacity: Maximum number of entries. Setting it to zero disables the cache
+    */
+    void setCapacity(const size_t capacity);
+    size_t capacity() const;
+
+    //Statistics
+    size_t size() const;
+    size_t hits() const {return m_hits.load(std::memory_order_relaxed);};
+    size_t misses() const {return m_misses.load(std::memory_order_relaxed);};
+    void resetStatistics();
+
+    /**
+    * @brief Removes every stored canvas. Capacity and statistics are left untouched
+    */
+    void clear();
+
+private:
+    TextRasterCache() = default;
+
+    //Lookup key. The text view either points to the caller's string or to the string owned by the cache entry
+    struct Key {
+        std::string_view text;
+        float fontSize;
+        cv::Scalar color;
+        int font;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        std::string text;
+        float fontSize;
+        cv::Scalar color;
+        int font;
+        cv::Mat canvas;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    bool find(const Key& key, cv::Mat& out);
+    void insert(const Key& key, const cv::Mat& canvas);
+    void evictExcess();
+
+private:
+    mutable std::mutex m_mutex;
+    EntryList m_entries;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> m_lookup;
+    size_t m_capacity = DEFAULT_CAPACITY;
+
+    std::atomic<size_t> m_hits{0};
+    std::atomic<size_t> m_misses{0};
+};
+
+#endif // TEXTRASTERCACHE_H
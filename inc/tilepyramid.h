@@ -0,0 +1,96 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include "colormapkernel.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <opencv2/core/mat.hpp>
+
+
+class TilePyramid
+{
+public:
+    static constexpr int DEFAULT_TILE_SIZE = 256;
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    /**
+    * @brief Describes a multi-resolution pyramid of the colormap indices of a large source. Level "l" is the source downsampled by 2^l, each level is split
+    * into square tiles. Tiles are only computed when a viewport needs them, from the source for the first level and from the four tiles below otherwise,
+    * and they are cached. The source isn't copied, so it should stay intact while the pyramid is used. The cache is guarded, so a pyramid can be shared by
+    * colormaps that are rendered concurrently
+    * @param source: single channel array, any depth
+    * @param lower: the value that gets the first color. If it's nullopted, the smallest value of the source is used
+    * @param upper: the value that gets the last color. If it's nullopted, the largest value of the source is used
+    * @param downsampling: reduction of the pixels that are merged by the coarser levels and by the viewports, None is handled as Nearest
+    * @param tileSize: width and height of the tiles in pixels
+    */
+    explicit TilePyramid(const cv::Mat& source, const std::optional<double> lower = {}, const std::optional<double> upper = {},
+                         const Downsampling downsampling = Downsampling::Area, const int tileSize = DEFAULT_TILE_SIZE);
+
+    /**
+    * @brief Renders the indices of a viewport from the level whose resolution is the closest one above the output size. Only the tiles of that level
+    * which cover the viewport are touched, so the cost depends on the output size instead of the source size once the tiles are cached
+    * @param sourceRect: the viewport in source pixels
+    * @param size: the output size
+    * @param out: CV_8U indices of the viewport, colorize them with the bounds 0 and 255
+    */
+    void render(const cv::Rect& sourceRect, const cv::Size& size, cv::Mat& out);
+
+    /**
+    * @brief Sets the maximum number of the tiles to be cached. Least recently used tiles are evicted first
+    */
+    void setCapacity(const size_t capacity);
+
+    //Getters
+    cv::Size getSourceSize() const {return m_source.size();};
+    std::pair<double, double> getRange() const {return {m_lower, m_upper};};
+    int getLevelCount() const {return m_levelCount;};
+    int getTileSize() const {return m_tileSize;};
+    size_t capacity() const;
+    size_t size() const;
+
+    //Number of the tiles that have been computed, cached tiles aren't computed again until they are evicted
+    size_t computedTiles() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        cv::Mat tile;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    cv::Size levelSize(const int level) const;
+
+    cv::Mat tile(const int level, const int column, const int row);
+    cv::Mat computeTile(const int level, const int column, const int row);
+
+    /**
+    * @brief Copies the part of a level that is inside the rectangle from the tiles that cover it
+    */
+    void composeLevel(const int level, const cv::Rect& levelRect, cv::Mat& out);
+
+    //Should be called while the mutex is locked
+    void evictExcess();
+
+private:
+    cv::Mat m_source;
+    double m_lower;
+    double m_upper;
+    Downsampling m_downsampling;
+    int m_tileSize;
+    int m_levelCount;
+
+    //Most recently used tiles are at the front. Every cache member is guarded by the mutex, tiles are computed outside of the lock
+    EntryList m_tiles;
+    std::unordered_map<uint64_t, EntryList::iterator> m_lookup;
+    size_t m_capacity = DEFAULT_CAPACITY;
+    size_t m_computedTiles = 0;
+    mutable std::mutex m_mutex;
+};
+
+#endif // TILEPYRAMID_H
@@ -1,5 +1,8 @@
 #include "colormap.h"
 #include "PlotUtils.h"
+#include "colormapkernel.h"
+#include "histogrambinning.h"
+#include <cmath>
 
 //Compile time constants
 constexpr int OFFSET_COLORMAP_COLORBAR = 8;
@@ -11,6 +14,7 @@ constexpr int COLORMAP_BORDER_THICKNESS = 1;
 constexpr int DEFAULT_NUMBER_OF_COLORBAR_AXES = 6;
 constexpr int MINIMUM_COLORBAR_AXIS_DISTANCE = 30;
 constexpr int COLORMAP_BORDER_LENGTH = (2 * COLORMAP_BORDER_THICKNESS);
+constexpr int MINIMUM_DOWNSAMPLED_COLORMAP_LENGTH = 200;
 
 
 //This namespace should be dominant for the scope of this file
@@ -30,12 +34,28 @@ namespace{
         cv::applyColorMap(colorbar, colorbar, colormapType);
         return colorbar;
     }
+
+    //Copies of a colormap share its buffers. A shared buffer is replaced by one of its own before it's written in place, the content is only
+    //copied if it's kept
+    void detachBuffer(cv::Mat& buffer, const bool keepContent)
+    {
+        if(buffer.u == nullptr || buffer.u->refcount <= 1)
+            return;
+
+        buffer = (keepContent)? buffer.clone() : cv::Mat(buffer.size(), buffer.type());
+    }
 }
 
-Colormap::Colormap(const cv::Mat &target, const cv::ColormapTypes colormapType) : m_colormapType(colormapType)
+Colormap::Colormap(const cv::Mat &target, const cv::ColormapTypes colormapType) :
+    m_lookupTable(ColormapKernel::lookupTable(colormapType)),
+    m_colormapType(colormapType)
 {
-    cv::normalize(target, m_colormap, 0, UCHAR_MAX, cv::NormTypes::NORM_MINMAX);
-    cv::applyColorMap(m_colormap, m_colormap, colormapType);
+    //Keep the normalized indices, colors are only looked up for the displayed pixels. Like cv::applyColorMap, BGR targets are indexed by their gray levels
+    cv::normalize(target, m_indices, 0, UCHAR_MAX, cv::NormTypes::NORM_MINMAX, CV_8U);
+    if(m_indices.channels() == 3){
+        cv::cvtColor(m_indices, m_indices, cv::COLOR_BGR2GRAY);
+    }
+    m_viewport = cv::Rect(0, 0, m_indices.cols, m_indices.rows);
 
     double targetMin{};
     double targetMax{};
@@ -47,12 +67,12 @@ Colormap::Colormap(const cv::Mat &target, const cv::ColormapTypes colormapType)
 Colormap::Colormap(const cv::Mat& target,
                    const std::optional<double> t_colormap_min,
                    const std::optional<double> t_colormap_max,
-                   const cv::ColormapTypes colormapType): m_colormapType(colormapType)
+                   const cv::ColormapTypes colormapType):
+    m_lookupTable(ColormapKernel::lookupTable(colormapType)),
+    m_colormapType(colormapType)
 {
     //Get the minimum and maximum value in an array
-    double targetMin{};
-    double targetMax{};
-    cv::minMaxLoc(target, &targetMin, &targetMax);
+    const auto[targetMin, targetMax] = HistogramBinning::minMax(target);
 
     //Deduce the colormap range and assign it to the member
     const double colormap_min = (t_colormap_min)? *t_colormap_min : targetMin;
@@ -69,37 +89,176 @@ Colormap::Colormap(const cv::Mat& target,
         throw std::runtime_error("At least one element should be inside of the colormap bounds");
     }
 
+    //Truncate the pixels to the colormap bounds and normalize the truncated pixels to 0-255 in a single pass. Normalization spans the extremes of the
+    //truncated pixels, which are the colormap bounds limited by the extremes of the target. Colors are only looked up for the displayed pixels
+    ColormapKernel::quantize(target, std::max(targetMin, colormap_min), std::min(targetMax, colormap_max), m_indices);
+    m_viewport = cv::Rect(0, 0, m_indices.cols, m_indices.rows);
+}
+
+Colormap::Colormap(const std::shared_ptr<TilePyramid> &pyramid, const cv::ColormapTypes colormapType) :
+    m_lookupTable(ColormapKernel::lookupTable(colormapType)),
+    m_pyramid(pyramid),
+    m_colormapType(colormapType)
+{
+    if(!m_pyramid){
+        throw std::invalid_argument("Tile pyramid of the colormap cannot be null");
+    }
+
+    m_viewport = cv::Rect(cv::Point(), m_pyramid->getSourceSize());
+    m_colormapRange = m_pyramid->getRange();
+}
+
+Colormap::Colormap(const cv::Size &size, const std::pair<double, double> &colormapRange, const cv::ColormapTypes colormapType) :
+    m_indices(cv::Mat::zeros(size, CV_8U)),
+    m_lookupTable(ColormapKernel::lookupTable(colormapType)),
+    m_viewport(cv::Point(), size),
+    m_colormapType(colormapType),
+    m_colormapRange(colormapRange)
+{
+    ColormapKernel::colorize(m_indices, 0, UCHAR_MAX, m_lookupTable, m_ringColors);
+}
+
+Colormap Colormap::waterfall(const int width, const int rowCount, const double colormap_min, const double colormap_max, const cv::ColormapTypes colormapType)
+{
+    if(width <= 0 || rowCount <= 0){
+        throw std::invalid_argument("Width and row count of the waterfall should be positive");
+    }
+    if(colormap_min > colormap_max){
+        throw std::runtime_error("Minimum colormap bound should not be larger than the maximum bound");
+    }
+
+    return Colormap(cv::Size(width, rowCount), {colormap_min, colormap_max}, colormapType);
+}
 
-    //Truncate the pixels that are outside of the lower and upper bounds of the colormap boundaries
-    cv::Mat thresholded;
-    cv::threshold(target, thresholded, colormap_max, colormap_max, cv::ThresholdTypes::THRESH_TRUNC);
-    thresholded.setTo(colormap_min, thresholded < colormap_min);
+void Colormap::setViewport(const cv::Rect &sourceRect)
+{
+    if(isWaterfall()){
+        throw std::runtime_error("Viewport of waterfalls cannot be set");
+    }
 
-    //Normalize the target to the range of the colormap
-    cv::Mat normalized;
-    cv::normalize(thresholded, normalized, 0, UCHAR_MAX, cv::NormTypes::NORM_MINMAX, CV_8U);
+    const cv::Size sourceSize = (m_pyramid)? m_pyramid->getSourceSize() : m_indices.size();
+    if(sourceRect.empty() || (sourceRect & cv::Rect(cv::Point(), sourceSize)) != sourceRect){
+        throw std::invalid_argument("Viewport should be a non-empty rectangle within the colormap");
+    }
 
-    //Apply the colormap
-    cv::applyColorMap(normalized, m_colormap, colormapType);
+    if(m_viewport != sourceRect){
+        m_viewport = sourceRect;
+        m_displayIndices.release();
+        markModified();
+    }
+}
+
+void Colormap::update(const cv::Mat &frame)
+{
+    if(m_pyramid){
+        throw std::runtime_error("Colormaps of tile pyramids cannot be updated");
+    }
+    if(frame.size() != m_indices.size()){
+        throw std::invalid_argument("Frame should have the size of the colormap");
+    }
+
+    //Frames are normalized like the range constructor does, over the colormap bounds limited by the extremes of the frame. Rows of waterfalls
+    //are always scaled to the colormap bounds, so the history has to be scaled to them as well
+    auto[colormapMin, colormapMax] = m_colormapRange;
+    if(!isWaterfall()){
+        const auto[frameMin, frameMax] = HistogramBinning::minMax(frame);
+        if((frameMin > colormapMax) || (frameMax < colormapMin)){
+            throw std::runtime_error("At least one element should be inside of the colormap bounds");
+        }
+        colormapMin = std::max(frameMin, colormapMin);
+        colormapMax = std::min(frameMax, colormapMax);
+    }
+
+    //Indices are written into their own buffer, so the frames don't allocate unless the buffer is shared with a copy
+    detachBuffer(m_indices, false);
+    ColormapKernel::quantize(frame, colormapMin, colormapMax, m_indices);
+
+    //The rows of the frame become the history of waterfalls from the oldest to the newest
+    if(isWaterfall()){
+        detachBuffer(m_ringColors, false);
+        ColormapKernel::colorize(m_indices, 0, UCHAR_MAX, m_lookupTable, m_ringColors);
+        m_ringHead = 0;
+    }
+
+    redrawColormapArea();
+}
+
+void Colormap::appendRow(const cv::Mat &row)
+{
+    if(!isWaterfall()){
+        throw std::runtime_error("Rows can only be appended to waterfalls");
+    }
+    if(row.rows != 1 || row.cols != m_indices.cols){
+        throw std::invalid_argument("Row should have a single row with the width of the waterfall");
+    }
+
+    //Only the appended row is quantized and colorized, it replaces the oldest row of the ring. The other rows of a ring that is shared with
+    //a copy are kept, the copy has a ring head of its own
+    const auto&[colormapMin, colormapMax] = m_colormapRange;
+    detachBuffer(m_indices, true);
+    detachBuffer(m_ringColors, true);
+    cv::Mat indexRow = m_indices.row(m_ringHead);
+    cv::Mat colorRow = m_ringColors.row(m_ringHead);
+    ColormapKernel::quantize(row, colormapMin, colormapMax, indexRow, 1);
+    ColormapKernel::colorize(indexRow, 0, UCHAR_MAX, m_lookupTable, colorRow, 1);
+    m_ringHead = (m_ringHead + 1) % m_indices.rows;
+
+    redrawColormapArea();
+}
+
+void Colormap::redrawColormapArea()
+{
+    //The decorations don't depend on the data, only the colormap area of an up to date canvas has to be drawn again
+    if(!isCanvasUpToDate(revision())){
+        m_displayIndices.release();
+        markModified();
+        return;
+    }
+
+    //The canvas is drawn again in place, so it stays up to date for the new revision
+    markModified();
+    cv::Mat colormapArea = m_canvas(m_colormapArea);
+    drawColormapArea(colormapArea, true);
+    markRendered(revision());
 }
 
 auto Colormap::generate() -> cv::Mat
 {
-    if(m_colormap.empty()){
+    //Nothing has changed since the last render
+    if(isCanvasUpToDate(revision()))
+        return m_canvas;
+
+    //Each render provides a new canvas, so that the previously returned canvases stay intact. Only the canvases that the element has
+    //allocated are kept, the buffers of the callers can be modified by them at any time
+    cv::Mat out;
+    m_colormapArea = drawCanvas(out);
+    m_canvas = out;
+    markRendered(revision());
+    return out;
+}
+
+void Colormap::generate(cv::Mat &out)
+{
+    drawCanvas(out);
+}
+
+auto Colormap::drawCanvas(cv::Mat &out) -> cv::Rect
+{
+    if(m_indices.empty() && !m_pyramid){
         throw std::runtime_error("The colormap target cannot be empty");
     }
 
-    //Generate the title and x-Axis text but don't place it on the canvas yet. Size of these canvases will determine the size of the main canvas
-    cv::Mat xAxisCanvas = (m_xAxisText.empty())? cv::Mat() : generateText(m_xAxisSize, m_xAxisText, m_xAxisColor);
-    cv::Mat titleCanvas = (m_title.empty())? cv::Mat() : generateText(m_titleSize, m_title, m_titleColor);
+    //Measure the title and x-Axis text but don't render them yet. Size of these canvases will determine the size of the main canvas
+    const cv::Size xAxisCanvasSize = (m_xAxisText.empty())? cv::Size() : measureText(m_xAxisSize, m_xAxisText);
+    const cv::Size titleCanvasSize = (m_title.empty())? cv::Size() : measureText(m_titleSize, m_title);
 
     //There is a lower limit on the sizes that a canvas can have
-    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvas.size(), xAxisCanvas.size());
+    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvasSize, xAxisCanvasSize);
     canvasSize.height = std::max(canvasSize.height, minimumCanvasSize.height);
     canvasSize.width = std::max(canvasSize.width, minimumCanvasSize.width);
 
-    //Generate a blank canvas
-    m_canvas = cv::Mat(canvasSize, CV_8UC3, white);
+    //Prepare a blank canvas on the caller's buffer
+    prepareCanvas(out);
 
     //This counter keeps track of the last row position on the canvas
     int canvasRowCounter = 0;
@@ -107,29 +266,41 @@ auto Colormap::generate() -> cv::Mat
     //Add top padding to the row counter
     canvasRowCounter += CANVAS_HEIGHT_PADDING;
 
-    //Place the title canvas that has previously been generated
-    if (!titleCanvas.empty()) {
-        centerElement(titleCanvas, cv::Size{canvasSize.width, 0}, AlignmentType::WidthOnly);
-        titleCanvas.copyTo(m_canvas(cv::Rect(0, canvasRowCounter, titleCanvas.cols, titleCanvas.rows)));
+    //Render the title and place it on the canvas
+    if (!m_title.empty()) {
+        const cv::Mat titleCanvas = generateText(m_titleSize, m_title, m_titleColor);
+        placeElement(titleCanvas, out, cv::Rect(0, canvasRowCounter, canvasSize.width, titleCanvas.rows), AlignmentType::WidthOnly);
 
         canvasRowCounter += titleCanvas.rows + PADDING_TITLE_COLORMAP;
     }
 
-    //Generate the colormap and place it on canvas
-    cv::Mat colormapCanvas = generateColormapCanvas(titleCanvas.rows, xAxisCanvas.rows);
-    const int colormapAllocatedHeight = m_canvas.rows - totalHeightPadding() - titleCanvas.rows - xAxisCanvas.rows;
-    centerElement(colormapCanvas, cv::Size{canvasSize.width, colormapAllocatedHeight}, AlignmentType::WholeShape);
-    colormapCanvas.copyTo(m_canvas(cv::Rect(0, canvasRowCounter, colormapCanvas.cols, colormapCanvas.rows)));
-
-    //Place the x-axis text that previously generated
-    if (!xAxisCanvas.empty()) {
-        canvasRowCounter += colormapCanvas.rows + PADDING_COLORMAP_XAXIS;
-        centerElement(xAxisCanvas, cv::Size{canvasSize.width, 0}, AlignmentType::WidthOnly);
-        xAxisCanvas.copyTo(m_canvas(cv::Rect(0, canvasRowCounter, xAxisCanvas.cols, xAxisCanvas.rows)));
+    //Draw the colormap directly on the center of its allocated area
+    const cv::Size colormapSize = colormapDisplaySize(titleCanvasSize.height, xAxisCanvasSize.height);
+    const int canvasWidthWithoutColormap = colorbarTotalWidth() + COLORMAP_BORDER_LENGTH + yAxisTextWidth();
+    const cv::Size colormapCanvasSize{colormapSize.width + canvasWidthWithoutColormap, colormapSize.height + COLORMAP_BORDER_LENGTH + xAxisTextHeight()};
+    const int colormapAllocatedHeight = canvasSize.height - totalHeightPadding() - titleCanvasSize.height - xAxisCanvasSize.height;
+    const int colormapCanvasPos_x = (canvasSize.width - colormapCanvasSize.width) / 2;
+    const int colormapCanvasPos_y = canvasRowCounter + ((colormapAllocatedHeight - colormapCanvasSize.height) / 2);
+    cv::Mat colormapCanvas = out(cv::Rect(colormapCanvasPos_x, colormapCanvasPos_y, colormapCanvasSize.width, colormapCanvasSize.height));
+    const cv::Rect colormapArea = drawColormapCanvas(colormapCanvas, colormapSize) + cv::Point(colormapCanvasPos_x, colormapCanvasPos_y);
+
+    //Render the x-axis text and place it on the canvas
+    if (!m_xAxisText.empty()) {
+        const cv::Mat xAxisCanvas = generateText(m_xAxisSize, m_xAxisText, m_xAxisColor);
+        canvasRowCounter += colormapAllocatedHeight + PADDING_COLORMAP_XAXIS;
+        placeElement(xAxisCanvas, out, cv::Rect(0, canvasRowCounter, canvasSize.width, xAxisCanvas.rows), AlignmentType::WidthOnly);
     }
 
-    //Generate the histogram graph element.
-    return m_canvas;
+    return colormapArea;
+}
+
+cv::Size Colormap::requiredCanvasSize()
+{
+    const cv::Size titleCanvasSize = (m_title.empty())? cv::Size() : measureText(m_titleSize, m_title);
+    const cv::Size xAxisCanvasSize = (m_xAxisText.empty())? cv::Size() : measureText(m_xAxisSize, m_xAxisText);
+    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvasSize, xAxisCanvasSize);
+
+    return cv::Size{std::max(canvasSize.width, minimumCanvasSize.width), std::max(canvasSize.height, minimumCanvasSize.height)};
 }
 
 auto Colormap::calculateMinimumCanvasSize(const cv::Size titleCanvasSize, const cv::Size xAxisCanvasSize) -> cv::Size
@@ -140,8 +311,9 @@ auto Colormap::calculateMinimumCanvasSize(const cv::Size titleCanvasSize, const
     m_yAxisTextSize = allocateNumericTextSpace(DEFAULT_AXIS_NUMBER_SIZE, DUMMY_NUMBER, m_precision_y);
     m_colorbarTextSize = allocateNumericTextSpace(DEFAULT_AXIS_NUMBER_SIZE, DUMMY_NUMBER, m_colorbarPrecision);
 
-    const int minimumColormapHeight = m_colormap.rows + COLORMAP_BORDER_LENGTH + m_xAxisTextSize.height;
-    const int minimumColormapWidthWithColorbar = m_yAxisTextSize.width + COLORMAP_BORDER_LENGTH + m_colormap.cols + colorbarTotalWidth();
+    const cv::Size minimumColormapSize = minimumColormapDisplaySize();
+    const int minimumColormapHeight = minimumColormapSize.height + COLORMAP_BORDER_LENGTH + m_xAxisTextSize.height;
+    const int minimumColormapWidthWithColorbar = m_yAxisTextSize.width + COLORMAP_BORDER_LENGTH + minimumColormapSize.width + colorbarTotalWidth();
 
     //Combine minimum sizes
     const int totalHeight = titleCanvasSize.height + minimumColormapHeight + xAxisCanvasSize.height + totalHeightPadding();
@@ -151,15 +323,9 @@ auto Colormap::calculateMinimumCanvasSize(const cv::Size titleCanvasSize, const
 }
 
 
-auto Colormap::generateColormapCanvas(const int titleCanvasHeight, const int xAxisCanvasHeight) const -> cv::Mat
+auto Colormap::drawColormapCanvas(cv::Mat &out, const cv::Size &colormapSize) -> cv::Rect
 {
-    //Enlarge the colormap with the space available
-    cv::Mat colormap_resized = resizeColormap(titleCanvasHeight, xAxisCanvasHeight);
-
-    //Prepare the output canvas
-    const auto[colormapWidth, colormapHeight] = colormap_resized.size();
-    const int canvasWidthWithoutColormap = colorbarTotalWidth() + COLORMAP_BORDER_LENGTH + yAxisTextWidth();
-    cv::Mat out(colormapHeight + COLORMAP_BORDER_LENGTH + xAxisTextHeight(), colormapWidth + canvasWidthWithoutColormap, CV_8UC3, white);
+    const auto[colormapWidth, colormapHeight] = colormapSize;
 
     //Draw a border around colormap to indicate the area
     cv::rectangle(out,
@@ -168,52 +334,105 @@ auto Colormap::generateColormapCanvas(const int titleCanvasHeight, const int xAx
                   COLORMAP_BORDER_THICKNESS,
                   cv::LINE_AA);
 
-    //Place the colormap on the canvas
+    //Draw the displayed pixels directly on the canvas
     int horizontalPos = yAxisTextWidth() + COLORMAP_BORDER_THICKNESS;
     int verticalPos = COLORMAP_BORDER_THICKNESS;
-    colormap_resized.copyTo(out(cv::Rect(horizontalPos, verticalPos, colormapWidth, colormapHeight)));
+    const cv::Rect colormapRect(horizontalPos, verticalPos, colormapWidth, colormapHeight);
+    cv::Mat colormapArea = out(colormapRect);
+    drawColormapArea(colormapArea, false);
 
     horizontalPos += colormapWidth + OFFSET_COLORMAP_COLORBAR;
 
-    //Generate a colorbar and place the colorbar on the canvas
-    cv::Mat colorbar = generateColorbar(colormapHeight + COLORMAP_BORDER_LENGTH);
-    colorbar.copyTo(out(cv::Rect(horizontalPos, 0, colorbar.cols, colorbar.rows)));
+    //Draw the colorbar on its area
+    cv::Mat colorbarCanvas = out(cv::Rect(horizontalPos, 0, colorbarTotalWidth() - OFFSET_COLORMAP_COLORBAR, colormapHeight + COLORMAP_BORDER_LENGTH));
+    drawColorbar(colorbarCanvas);
 
     //Add axis texts. Remove colorbar area to prevent wrong element width estimation
     cv::Mat colorbar_removed = out.colRange(0, out.cols - colorbarTotalWidth());
-    addAxis(colorbar_removed, { 0, 0 }, { 0, 0 }, { 0, m_colormap.cols }, { 0, m_colormap.rows });
+    addAxis(colorbar_removed, { 0, 0 }, { 0, 0 }, { m_viewport.x, m_viewport.x + m_viewport.width }, { m_viewport.y, m_viewport.y + m_viewport.height });
 
-    return out;
+    return colormapRect;
 }
 
-auto Colormap::generateColorbar(const int colormapHeight) const -> cv::Mat
+void Colormap::drawColormapArea(cv::Mat &area, const bool isDataModified)
 {
-    //Prepare the canvas
-    cv::Mat out(colormapHeight, colorbarTotalWidth() - OFFSET_COLORMAP_COLORBAR, CV_8UC3, white);
+    //Waterfalls that are displayed with their own size are composed of the colorized rows, from the oldest row to the end of the ring and from
+    //the beginning of the ring to the newest row
+    if(isWaterfall() && area.size() == m_indices.size()){
+        const int olderRows = m_indices.rows - m_ringHead;
+        m_ringColors.rowRange(m_ringHead, m_indices.rows).copyTo(area.rowRange(0, olderRows));
+        if(m_ringHead > 0){
+            m_ringColors.rowRange(0, m_ringHead).copyTo(area.rowRange(olderRows, area.rows));
+        }
+        return;
+    }
 
-    cv::Mat colorbar = getColorbar(colormapHeight, m_colormapType);
-    colorbar.copyTo(out(cv::Rect(0, 0, COLORBAR_WIDTH, colormapHeight)));
+    //Fit the viewport to the space available. The display size indices are kept until the display size or the data changes, pyramids only
+    //touch the tiles of the viewport
+    if(m_pyramid){
+        detachBuffer(m_displayIndices, false);
+        m_pyramid->render(m_viewport, area.size(), m_displayIndices);
+    }
+    else if(isWaterfall()){
+        resampleRing(area.size());
+    }
+    else if(isDataModified || m_displayIndices.size() != area.size()){
+        detachBuffer(m_displayIndices, false);
+        ColormapKernel::resample(m_indices(m_viewport), area.size(), m_downsampling, m_displayIndices);
+    }
+
+    //The display is small, so it is colorized serially without allocating
+    ColormapKernel::colorize(m_displayIndices, 0, UCHAR_MAX, m_lookupTable, area, 1);
+}
+
+void Colormap::resampleRing(const cv::Size &size)
+{
+    //Both segments of the ring are fitted to their share of the displayed rows, so the history isn't rearranged. Every append moves the
+    //boundary between the segments, so the whole display is resampled
+    detachBuffer(m_displayIndices, false);
+    m_displayIndices.create(size, CV_8U);
+    const int olderRows = m_indices.rows - m_ringHead;
+    const int olderDisplayRows = static_cast<int>(std::lround(static_cast<double>(size.height) * olderRows / m_indices.rows));
+
+    const auto lambda_resampleSegment = [&](const cv::Range& ringRows, const cv::Range& displayRows){
+        if(ringRows.size() > 0 && displayRows.size() > 0){
+            cv::Mat displaySegment = m_displayIndices.rowRange(displayRows);
+            ColormapKernel::resample(m_indices.rowRange(ringRows), displaySegment.size(), m_downsampling, displaySegment);
+        }
+    };
+    lambda_resampleSegment(cv::Range(m_ringHead, m_indices.rows), cv::Range(0, olderDisplayRows));
+    lambda_resampleSegment(cv::Range(0, m_ringHead), cv::Range(olderDisplayRows, size.height));
+}
+
+void Colormap::drawColorbar(cv::Mat &out)
+{
+    const int colormapHeight = out.rows;
+
+    //The colorized gradient only depends on the height, so it is kept until the height changes
+    if(m_colorbarGradient.rows != colormapHeight){
+        m_colorbarGradient = getColorbar(colormapHeight, m_colormapType);
+    }
+    m_colorbarGradient.copyTo(out(cv::Rect(0, 0, COLORBAR_WIDTH, colormapHeight)));
 
-    //Generate each colorbar number
-    const int numberofColorbarAxes = std::min(DEFAULT_NUMBER_OF_COLORBAR_AXES, std::max(colorbar.rows / MINIMUM_COLORBAR_AXIS_DISTANCE, 1));
+    //Generate each colorbar number. Positions follow the same arithmetic as "PlotUtils::linspace" from the bottom to the top
+    const int numberofColorbarAxes = std::min(DEFAULT_NUMBER_OF_COLORBAR_AXES, std::max(colormapHeight / MINIMUM_COLORBAR_AXIS_DISTANCE, 1));
     const auto&[colormapMin, colormapMax] = m_colormapRange;
-    const auto colorbarAxes = PlotUtils::linspace(colormapMin, colormapMax, numberofColorbarAxes);
-    const auto colorbarPositions = PlotUtils::linspace(static_cast<double>(colormapHeight), 0.0, numberofColorbarAxes);
+    const double positionIncrement = -static_cast<double>(colormapHeight) / std::max(numberofColorbarAxes - 1, 1);
+    double positionCounter = colormapHeight - positionIncrement;
+    int axisCounter = 0;
 
     //Place each colorbar number
-    for(auto it_axes=colorbarAxes.cbegin(), it_pos=colorbarPositions.cbegin();it_axes != colorbarAxes.cend(); it_pos++, it_axes++){
+    PlotUtils::linspace_for_each(colormapMin, colormapMax, numberofColorbarAxes, [&](const double currentNumber){
         //Draw the axis line
-        const int pos = static_cast<int>(*it_pos);
+        const int pos = (++axisCounter == numberofColorbarAxes)? 0 : static_cast<int>(positionCounter += positionIncrement);
         cv::line(out, cv::Point{COLORBAR_WIDTH, pos}, cv::Point{COLORBAR_WIDTH + LENGTH_AXIS_LINE, pos}, cv::LINE_AA);
 
         //Draw the text
-        cv::Mat textCanvas = generateNumericText(DEFAULT_AXIS_NUMBER_SIZE, *it_axes, m_colorbarPrecision);
+        const cv::Mat textCanvas = generateNumericText(DEFAULT_AXIS_NUMBER_SIZE, currentNumber, m_colorbarPrecision);
         int yStart = std::max(pos - (textCanvas.rows / 2), 0);
         yStart = std::min(yStart, colormapHeight - textCanvas.rows);
         textCanvas.copyTo(out(cv::Rect(COLORBAR_WIDTH + LENGTH_AXIS_LINE, yStart, textCanvas.cols, textCanvas.rows)));
-    }
-
-    return out;
+    });
 }
 
 auto Colormap::colorbarTotalWidth() const -> int
@@ -229,20 +448,19 @@ auto Colormap::totalHeightPadding() const -> int
     return (2 * CANVAS_HEIGHT_PADDING) + padding_title_colormap + padding_colormap_xAxis;
 }
 
-auto Colormap::resizeColormap(const int titleCanvasHeight, const int xAxisCanvasHeight) const -> cv::Mat
+auto Colormap::colormapDisplaySize(const int titleCanvasHeight, const int xAxisCanvasHeight) const -> cv::Size
 {
     const int canvasWidthWithoutColormap = colorbarTotalWidth() + COLORMAP_BORDER_LENGTH + yAxisTextWidth();
 
     //Determine the available size for colormap to place
-    const auto& [canvasWidth, canvasHeight] = m_canvas.size();
+    const auto& [canvasWidth, canvasHeight] = canvasSize;
     const int colormapAvailableWidth = canvasWidth - (2 * CANVAS_WIDTH_PADDING) - canvasWidthWithoutColormap;
     const int colormapAvailableHeight = canvasHeight - totalHeightPadding() - titleCanvasHeight - xAxisTextHeight() - xAxisCanvasHeight - COLORMAP_BORDER_LENGTH;
 
-    //Resize the colormap considering the aspect ratio and the available space
-
-    const float aspectRatio = static_cast<float>(m_colormap.cols) / static_cast<float>(m_colormap.rows);
-    const float availableZoomFactor_y = static_cast<float>(colormapAvailableWidth) / m_colormap.cols;
-    const float availableZoomFactor_x = static_cast<float>(colormapAvailableHeight) / m_colormap.rows;
+    //Fit the colormap considering the aspect ratio and the available space
+    const float aspectRatio = static_cast<float>(m_viewport.width) / static_cast<float>(m_viewport.height);
+    const float availableZoomFactor_y = static_cast<float>(colormapAvailableWidth) / m_viewport.width;
+    const float availableZoomFactor_x = static_cast<float>(colormapAvailableHeight) / m_viewport.height;
     int colormapWidth{};
     int colormapHeight{};
     if(availableZoomFactor_y >= availableZoomFactor_x){
@@ -253,18 +471,41 @@ auto Colormap::resizeColormap(const int titleCanvasHeight, const int xAxisCanvas
         colormapWidth = colormapAvailableWidth;
         colormapHeight = static_cast<int>(colormapWidth / aspectRatio);
     }
-    cv::Mat ret;
-    cv::resize(m_colormap, ret, {colormapWidth, colormapHeight}, 0, 0, cv::InterpolationFlags::INTER_NEAREST);
-    return ret;
+    return cv::Size{colormapWidth, colormapHeight};
+}
+
+auto Colormap::minimumColormapDisplaySize() const -> cv::Size
+{
+    //Without downsampling every pixel of the viewport requires a display pixel. Pyramids are always downsampled
+    const int longerSide = std::max(m_viewport.width, m_viewport.height);
+    if((m_downsampling == Downsampling::None && !m_pyramid) || longerSide <= MINIMUM_DOWNSAMPLED_COLORMAP_LENGTH)
+        return m_viewport.size();
+
+    //Downsampled colormaps only require the longer side to be displayed with a limited length, the aspect ratio is kept
+    const double scale = static_cast<double>(MINIMUM_DOWNSAMPLED_COLORMAP_LENGTH) / longerSide;
+    return cv::Size{std::max(static_cast<int>(m_viewport.width * scale), 1), std::max(static_cast<int>(m_viewport.height * scale), 1)};
+}
+
+void Colormap::setDownsampling(const Downsampling downsampling)
+{
+    if(m_downsampling != downsampling){
+        m_downsampling = downsampling;
+        m_displayIndices.release();
+        markModified();
+    }
 }
 
 
 Colormap Colormap::clone() const
 {
-    //Clone all cv::Mat types and copy everything else
+    //Clone all cv::Mat types and copy everything else. The tile pyramid is shared
     Colormap out(*this);
     out.m_canvas = m_canvas.clone();
-    out.m_colormap = m_colormap.clone();
+    out.m_indices = m_indices.clone();
+    out.m_lookupTable = m_lookupTable.clone();
+    out.m_displayIndices = m_displayIndices.clone();
+    out.m_ringColors = m_ringColors.clone();
+    out.m_colorbarGradient = m_colorbarGradient.clone();
 
     return out;
 }
\ No newline at end of file
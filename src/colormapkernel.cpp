@@ -0,0 +1,240 @@
+#include "colormapkernel.h"
+#include "histogrambinning.h"
+#include <algorithm>
+#include <numeric>
+#include <cfloat>
+#include <stdexcept>
+#include <type_traits>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/version.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+//Vectorized scaling relies on the function style universal intrinsics of OpenCV 4.9
+#if (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 9)) && (CV_SIMD || CV_SIMD_SCALABLE)
+#define COLORMAPKERNEL_SIMD 1
+#else
+#define COLORMAPKERNEL_SIMD 0
+#endif
+
+
+namespace {
+    //Number of the pixels whose indices are computed before their colors are looked up. The indices stay in the L1 cache
+    constexpr int PIXELS_PER_BLOCK = 256;
+
+    //Scaling of cv::normalize with NORM_MINMAX, which converts double values in double precision and the other depths in single precision
+    template<typename Real>
+    struct IndexScale
+    {
+        IndexScale(const double lower, const double upper) :
+            lower(static_cast<Real>(lower)),
+            upper(static_cast<Real>(upper)),
+            scale(static_cast<Real>((upper - lower > DBL_EPSILON)? UCHAR_MAX / (upper - lower) : 0.0)),
+            shift(static_cast<Real>(-lower * ((upper - lower > DBL_EPSILON)? UCHAR_MAX / (upper - lower) : 0.0)))
+        {}
+
+        //NaN fails the comparison with the lower bound, so it takes the lower bound
+        int index(Real value) const
+        {
+            value = (value > lower)? value : lower;
+            value = (value < upper)? value : upper;
+            return cvRound((value * scale) + shift);
+        };
+
+        Real lower;
+        Real upper;
+        Real scale;
+        Real shift;
+    };
+
+#if COLORMAPKERNEL_SIMD
+    //Computes the indices of the leading part of a block with vector lanes and returns the number of the pixels that have been computed.
+    //Multiplication and addition are kept separate like the scalar scaling
+    int vectorIndices(const float* values, const int pixels, const IndexScale<float>& indexScale, int* indices)
+    {
+        const cv::v_float32 lower = cv::vx_setall_f32(indexScale.lower);
+        const cv::v_float32 upper = cv::vx_setall_f32(indexScale.upper);
+        const cv::v_float32 scale = cv::vx_setall_f32(indexScale.scale);
+        const cv::v_float32 shift = cv::vx_setall_f32(indexScale.shift);
+        const int step = cv::VTraits<cv::v_float32>::vlanes();
+
+        int i = 0;
+        for(; i + step <= pixels; i += step){
+            const cv::v_float32 clamped = cv::v_min(cv::v_max(cv::vx_load(values + i), lower), upper);
+            cv::v_store(indices + i, cv::v_round(cv::v_add(cv::v_mul(clamped, scale), shift)));
+        }
+        cv::vx_cleanup();
+        return i;
+    }
+#endif
+
+    //Scales a span of values to indices and writes what the functor looks up for each index
+    template<typename T, typename Out, typename LookupFunctor>
+    void scaleSpan(const T* data, const size_t pixels, const double lower, const double upper, const LookupFunctor& lambda_lookup, Out* out)
+    {
+        using Real = std::conditional_t<std::is_same_v<T, double>, double, float>;
+        const IndexScale<Real> indexScale(lower, upper);
+
+        int indices[PIXELS_PER_BLOCK];
+        Real values[PIXELS_PER_BLOCK];
+        for(size_t begin = 0; begin < pixels; begin += PIXELS_PER_BLOCK){
+            const int length = static_cast<int>(std::min<size_t>(PIXELS_PER_BLOCK, pixels - begin));
+
+            //Integer values are converted to the precision of the scaling first, so that every depth but double shares the vector lanes
+            const Real* blockValues = nullptr;
+            if constexpr (std::is_same_v<T, Real>){
+                blockValues = data + begin;
+            }
+            else{
+                std::copy(data + begin, data + begin + length, values);
+                blockValues = values;
+            }
+
+            int i = 0;
+#if COLORMAPKERNEL_SIMD
+            if constexpr (std::is_same_v<Real, float>)
+                i = vectorIndices(blockValues, length, indexScale, indices);
+#endif
+            for(; i < length; i++){
+                indices[i] = indexScale.index(blockValues[i]);
+            }
+
+            //Lanes of NaN values may hold any index, so every index is kept within the table
+            Out* blockOut = out + begin;
+            for(i = 0; i < length; i++){
+                blockOut[i] = lambda_lookup(std::clamp(indices[i], 0, ColormapKernel::LOOKUP_TABLE_SIZE - 1));
+            }
+        }
+    }
+
+    void checkScaledInput(const cv::Mat& input)
+    {
+        if(input.empty())
+            throw std::invalid_argument("Array to be colorized cannot be empty");
+        if(input.channels() != 1 || input.dims > 2)
+            throw std::invalid_argument("Only single channel arrays with two dimensions can be colorized");
+        if(input.depth() > CV_64F)
+            throw std::invalid_argument("Colorization doesn't support the depth of the array");
+    }
+
+    //Scales the input into "out", which has the size of the input and the given type. Continuous arrays are processed as a single long row,
+    //which is split into stripes by their pixels, others are split by their rows
+    template<typename Out, typename LookupFunctor>
+    void scaleStripes(const cv::Mat& input, const double lower, const double upper, cv::Mat& out, const int outType, const int parallelism, const LookupFunctor& lambda_lookup)
+    {
+        //The input cannot be written while it is read
+        if(out.data == input.data)
+            out.release();
+        out.create(input.size(), outType);
+
+        const bool isFlat = input.isContinuous() && out.isContinuous();
+        const int rows = (isFlat)? 1 : input.rows;
+        const size_t rowPixels = (isFlat)? input.total() : static_cast<size_t>(input.cols);
+        const int stripes = HistogramBinning::stripeCount(input.total(), parallelism);
+
+        const auto lambda_scaleStripes = [&](const cv::Range& range){
+            for(int stripe = range.start; stripe < range.end; stripe++){
+                //Each stripe takes an even share of the rows, or of the pixels of the single row
+                const size_t first = rows * rowPixels * stripe / stripes;
+                const size_t last = rows * rowPixels * (stripe + 1) / stripes;
+                for(size_t begin = first; begin < last;){
+                    const int row = static_cast<int>(begin / rowPixels);
+                    const size_t column = begin % rowPixels;
+                    const size_t length = std::min(last - begin, rowPixels - column);
+
+                    Out* rowOut = out.ptr<Out>(row) + column;
+                    switch (input.depth()) {
+                    case CV_8U: scaleSpan(input.ptr<uint8_t>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    case CV_8S: scaleSpan(input.ptr<int8_t>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    case CV_16U: scaleSpan(input.ptr<uint16_t>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    case CV_16S: scaleSpan(input.ptr<int16_t>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    case CV_32S: scaleSpan(input.ptr<int32_t>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    case CV_32F: scaleSpan(input.ptr<float>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    case CV_64F: scaleSpan(input.ptr<double>(row) + column, length, lower, upper, lambda_lookup, rowOut); break;
+                    default: break;
+                    }
+                    begin += length;
+                }
+            }
+        };
+
+        if(stripes == 1)
+            lambda_scaleStripes(cv::Range(0, 1));
+        else
+            cv::parallel_for_(cv::Range(0, stripes), lambda_scaleStripes, stripes);
+    }
+
+    //Reduces each block of the indices that a display pixel covers to its extreme. Blocks of adjacent display pixels differ by one index at most
+    template<typename ReduceFunctor>
+    void reduceBlocks(const cv::Mat& indices, cv::Mat& out, ReduceFunctor&& lambda_reduce)
+    {
+        for(int y = 0; y < out.rows; y++){
+            const int rowBegin = static_cast<int>(static_cast<int64_t>(y) * indices.rows / out.rows);
+            const int rowEnd = std::max(rowBegin + 1, static_cast<int>(static_cast<int64_t>(y + 1) * indices.rows / out.rows));
+            uchar* outRow = out.ptr<uchar>(y);
+            for(int x = 0; x < out.cols; x++){
+                const int columnBegin = static_cast<int>(static_cast<int64_t>(x) * indices.cols / out.cols);
+                const int columnEnd = std::max(columnBegin + 1, static_cast<int>(static_cast<int64_t>(x + 1) * indices.cols / out.cols));
+
+                uchar extreme = indices.at<uchar>(rowBegin, columnBegin);
+                for(int r = rowBegin; r < rowEnd; r++){
+                    const uchar* indexRow = indices.ptr<uchar>(r);
+                    extreme = std::accumulate(indexRow + columnBegin, indexRow + columnEnd, extreme, lambda_reduce);
+                }
+                outRow[x] = extreme;
+            }
+        }
+    }
+}
+
+cv::Mat ColormapKernel::lookupTable(const cv::ColormapTypes colormapType)
+{
+    cv::Mat indices(1, LOOKUP_TABLE_SIZE, CV_8U);
+    for(int i = 0; i < LOOKUP_TABLE_SIZE; i++){
+        indices.at<uchar>(i) = static_cast<uchar>(i);
+    }
+
+    cv::Mat colors;
+    cv::applyColorMap(indices, colors, colormapType);
+    return colors;
+}
+
+void ColormapKernel::colorize(const cv::Mat &input, const double lower, const double upper, const cv::Mat &lookupTable, cv::Mat &out, const int parallelism)
+{
+    checkScaledInput(input);
+    if(lookupTable.type() != CV_8UC3 || lookupTable.total() != LOOKUP_TABLE_SIZE || !lookupTable.isContinuous())
+        throw std::invalid_argument("Lookup table should hold 256 continuous BGR colors");
+
+    const cv::Vec3b* colors = lookupTable.ptr<cv::Vec3b>();
+    scaleStripes<cv::Vec3b>(input, lower, upper, out, CV_8UC3, parallelism, [colors](const int index){ return colors[index]; });
+}
+
+void ColormapKernel::quantize(const cv::Mat &input, const double lower, const double upper, cv::Mat &out, const int parallelism)
+{
+    checkScaledInput(input);
+    scaleStripes<uchar>(input, lower, upper, out, CV_8U, parallelism, [](const int index){ return static_cast<uchar>(index); });
+}
+
+void ColormapKernel::resample(const cv::Mat &indices, const cv::Size &size, const Downsampling downsampling, cv::Mat &out)
+{
+    if(indices.empty() || indices.type() != CV_8UC1)
+        throw std::invalid_argument("Indices should be a non-empty CV_8UC1 array");
+
+    //Enlarged indices and indices that aren't downsampled keep the nearest index
+    const bool isShrinking = size.width < indices.cols || size.height < indices.rows;
+    if(!isShrinking || downsampling == Downsampling::None || downsampling == Downsampling::Nearest){
+        cv::resize(indices, out, size, 0, 0, cv::InterpolationFlags::INTER_NEAREST);
+        return;
+    }
+
+    if(downsampling == Downsampling::Area){
+        //Scaling is linear, so the average index is the index of the average value
+        cv::resize(indices, out, size, 0, 0, cv::InterpolationFlags::INTER_AREA);
+        return;
+    }
+
+    out.create(size, CV_8U);
+    if(downsampling == Downsampling::Max)
+        reduceBlocks(indices, out, [](const uchar lhs, const uchar rhs){ return std::max(lhs, rhs); });
+    else
+        reduceBlocks(indices, out, [](const uchar lhs, const uchar rhs){ return std::min(lhs, rhs); });
+}
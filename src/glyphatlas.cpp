@@ -0,0 +1,86 @@
+#include "glyphatlas.h"
+#include "opencv2/imgproc.hpp"
+#include "plotelementbase.h"
+#include "textmetrics.h"
+
+
+GlyphAtlas& GlyphAtlas::instance()
+{
+    static GlyphAtlas atlas;
+    return atlas;
+}
+
+bool GlyphAtlas::canRender(const std::string_view text)
+{
+    const auto lambda_isNumericGlyph = [](const char glyph){ return NUMERIC_GLYPHS.find(glyph) != std::string_view::npos; };
+    return !text.empty() && std::all_of(text.begin(), text.end(), lambda_isNumericGlyph);
+}
+
+size_t GlyphAtlas::glyphIndex(const char glyph)
+{
+    const size_t index = NUMERIC_GLYPHS.find(glyph);
+    if(index == std::string_view::npos)
+        throw std::runtime_error("Glyph atlas cannot render the given character");
+
+    return index;
+}
+
+cv::Mat GlyphAtlas::renderText(const std::string_view text, const float fontSize, const cv::Scalar &color, const int font, const cv::Size &canvasSize, const int margin)
+{
+    const std::shared_ptr<const GlyphSet> glyphs = glyphSet(fontSize, color, font, canvasSize.height, margin);
+    const TextMetrics::FontMetrics& metrics = TextMetrics::fontMetrics(font);
+
+    cv::Mat canvas(canvasSize, CV_8UC3, PainterConstants::white);
+    const cv::Rect canvasArea(0, 0, canvas.cols, canvas.rows);
+
+    //Pen positions follow the Hershey advance widths, exactly like cv::putText places consecutive glyphs.
+    //Overlapping anti-aliased edges are merged by keeping the darker value
+    int advanceUnits = 0;
+    for(const char curChar : text){
+        const cv::Mat& cell = glyphs->cells[glyphIndex(curChar)];
+        const cv::Rect cellArea(margin + cvRound(advanceUnits * fontSize) - glyphs->bleed, 0, cell.cols, cell.rows);
+        const cv::Rect targetArea = cellArea & canvasArea;
+        advanceUnits += metrics.advanceUnits[curChar - TextMetrics::FIRST_GLYPH];
+
+        if(targetArea.empty())
+            continue;
+
+        const cv::Rect sourceArea(targetArea.x - cellArea.x, 0, targetArea.width, targetArea.height);
+        cv::Mat target = canvas(targetArea);
+        cv::min(target, cell(sourceArea), target);
+    }
+
+    return canvas;
+}
+
+std::shared_ptr<const GlyphAtlas::GlyphSet> GlyphAtlas::glyphSet(const float fontSize, const cv::Scalar &color, const int font, const int canvasHeight, const int margin)
+{
+    const GlyphSetKey key{fontSize, font, canvasHeight, margin, color[0], color[1], color[2]};
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_glyphSets.find(key);
+    if(it == m_glyphSets.end()){
+        it = m_glyphSets.emplace(key, rasterizeGlyphSet(fontSize, color, font, canvasHeight, margin)).first;
+    }
+    return it->second;
+}
+
+std::shared_ptr<const GlyphAtlas::GlyphSet> GlyphAtlas::rasterizeGlyphSet(const float fontSize, const cv::Scalar &color, const int font, const int canvasHeight, const int margin)
+{
+    auto out = std::make_shared<GlyphSet>();
+
+    //Anti-aliased strokes can slightly exceed the advance width, so leave some space on both sides of each glyph
+    out->bleed = margin + 2;
+
+    const TextMetrics::FontMetrics& metrics = TextMetrics::fontMetrics(font);
+    for(size_t index = 0; index < NUMERIC_GLYPHS.size(); index++){
+        const char glyph = NUMERIC_GLYPHS[index];
+        const int advanceWidth = cvCeil(metrics.advanceUnits[glyph - TextMetrics::FIRST_GLYPH] * fontSize);
+
+        cv::Mat& cell = out->cells[index];
+        cell = cv::Mat(canvasHeight, advanceWidth + (2 * out->bleed), CV_8UC3, PainterConstants::white);
+        cv::putText(cell, cv::String(1, glyph), cv::Point{out->bleed, canvasHeight - margin}, font, fontSize, color, 1, cv::LINE_AA);
+    }
+
+    return out;
+}
@@ -0,0 +1,65 @@
+#include "gridlayout.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+
+GridLayout::GridLayout(const size_t rows, const size_t cols) :
+    m_rowHeights(rows, 0),
+    m_colWidths(cols, 0),
+    m_rowOffsets(rows + 1, 0),
+    m_colOffsets(cols + 1, 0)
+{
+    if(rows == 0 || cols == 0){
+        throw std::invalid_argument("number of rows and columns of the grid cannot be zero");
+    }
+}
+
+void GridLayout::arrange(const std::vector<cv::Size> &cellSizes)
+{
+    if(cellSizes.size() != rows() * cols()){
+        throw std::invalid_argument("number of cell sizes should match with the number of grid cells");
+    }
+
+    std::fill(m_rowHeights.begin(), m_rowHeights.end(), 0);
+    std::fill(m_colWidths.begin(), m_colWidths.end(), 0);
+
+    //Visit each cell once in row-major order
+    auto it_cell = cellSizes.cbegin();
+    for(int& rowHeight : m_rowHeights){
+        for(int& colWidth : m_colWidths){
+            rowHeight = std::max(rowHeight, it_cell->height);
+            colWidth = std::max(colWidth, it_cell->width);
+            it_cell++;
+        }
+    }
+
+    updateOffsets();
+}
+
+void GridLayout::arrange(const cv::Size &cellSize)
+{
+    if(cellSize.width < 0 || cellSize.height < 0){
+        throw std::invalid_argument("cell size cannot be negative");
+    }
+
+    std::fill(m_rowHeights.begin(), m_rowHeights.end(), cellSize.height);
+    std::fill(m_colWidths.begin(), m_colWidths.end(), cellSize.width);
+
+    updateOffsets();
+}
+
+cv::Rect GridLayout::cellArea(const size_t row, const size_t col) const
+{
+    return cv::Rect{m_colOffsets.at(col), m_rowOffsets.at(row), m_colWidths.at(col), m_rowHeights.at(row)};
+}
+
+void GridLayout::updateOffsets()
+{
+    //Offset of each row and column is the sum of the sizes before it
+    m_rowOffsets.front() = 0;
+    std::partial_sum(m_rowHeights.cbegin(), m_rowHeights.cend(), m_rowOffsets.begin() + 1);
+
+    m_colOffsets.front() = 0;
+    std::partial_sum(m_colWidths.cbegin(), m_colWidths.cend(), m_colOffsets.begin() + 1);
+}
@@ -2,6 +2,10 @@
 #include <numeric>
 #include "opencv2/imgproc.hpp"
 #include "PlotUtils.h"
+#include "histogrambinning.h"
+#include <array>
+#include <cmath>
+#include <tuple>
 
 //We will clearly use constants from this namespace
 using namespace PainterConstants;
@@ -10,6 +14,8 @@ using namespace PainterConstants;
 constexpr int PADDING_TITLE_HISTOGRAM = 10;
 constexpr int PADDING_HISTOGRAM_XAXIS = 10;
 constexpr int MINIMUM_HISTOGRAM_HEIGHT = 200;
+constexpr int MINIMUM_AGGREGATED_HISTOGRAM_WIDTH = 200;
+constexpr double PADDING_MAX_HEIGHT_PERCENTAGE = 0.95;
 
 
 Histogram::Histogram(const std::vector<size_t> &histogram, const std::vector<float> &bins) : m_histogram(histogram), m_bins(bins)
@@ -34,22 +40,24 @@ Histogram::Histogram(std::vector<size_t> &&histogram, std::vector<float> &&bins)
     }
 }
 
-Histogram::Histogram(const std::vector<size_t> &histogram) : m_histogram(histogram), m_bins(histogram.size())
+Histogram::Histogram(const std::vector<size_t> &histogram) : m_histogram(histogram)
 {
     if(m_histogram.empty()){
         throw(std::runtime_error("Histogram cannot be empty"));
     }
 
-    std::iota(m_bins.begin(), m_bins.end(), 1);
+    m_bins = BinsView(1, m_histogram.size(), m_histogram.size());
+    m_binRange = HistogramBinning::BinRange{m_histogram.size(), 1.0F, static_cast<float>(m_histogram.size() + 1)};
 }
 
-Histogram::Histogram(std::vector<size_t> &&histogram) : m_histogram(std::move(histogram)), m_bins(m_histogram.size())
+Histogram::Histogram(std::vector<size_t> &&histogram) : m_histogram(std::move(histogram))
 {
     if(m_histogram.empty()){
         throw(std::runtime_error("Histogram cannot be empty"));
     }
 
-    std::iota(m_bins.begin(), m_bins.end(), 1);
+    m_bins = BinsView(1, m_histogram.size(), m_histogram.size());
+    m_binRange = HistogramBinning::BinRange{m_histogram.size(), 1.0F, static_cast<float>(m_histogram.size() + 1)};
 }
 
 Histogram::Histogram(const std::vector<size_t> &histogram, const float binStart, const std::optional<float> binEnd_) : m_histogram(histogram)
@@ -59,7 +67,8 @@ Histogram::Histogram(const std::vector<size_t> &histogram, const float binStart,
     }
 
     const float binEnd = binEnd_.value_or(binStart + histogram.size());
-    m_bins = PlotUtils::linspace(binStart, binEnd, histogram.size());
+    m_bins = BinsView(binStart, binEnd, m_histogram.size());
+    m_binRange = HistogramBinning::BinRange{m_histogram.size(), binStart, binEnd};
 }
 
 Histogram::Histogram(std::vector<size_t> &&histogram, const float binStart, const std::optional<float> binEnd_) : m_histogram(std::move(histogram))
@@ -69,10 +78,12 @@ Histogram::Histogram(std::vector<size_t> &&histogram, const float binStart, cons
     }
 
     const float binEnd = binEnd_.value_or(binStart + m_histogram.size());
-    m_bins = PlotUtils::linspace(binStart, binEnd, m_histogram.size());
+    m_bins = BinsView(binStart, binEnd, m_histogram.size());
+    m_binRange = HistogramBinning::BinRange{m_histogram.size(), binStart, binEnd};
 }
 
-Histogram::Histogram(const cv::Mat &inArray, const std::optional<int> t_binSize, const std::optional<float> t_binStart, const std::optional<float> t_binEnd)
+Histogram::Histogram(const cv::Mat &inArray, const std::optional<int> t_binSize, const std::optional<float> t_binStart, const std::optional<float> t_binEnd,
+                     const std::optional<HistogramBinning::Sampling>& sampling)
 {
     if(t_binSize){
         if(*t_binSize == 0){
@@ -80,51 +91,362 @@ Histogram::Histogram(const cv::Mat &inArray, const std::optional<int> t_binSize,
         }
     }
 
-    // At least one of the range parameters isn't nullopt so auto-range will be necessary
+    // A sample stands in for the array if the array has more pixels than the requested samples. Only the size of the array is kept, the array itself
+    // is given again to refine the counts
+    const bool isSampled = sampling && sampling->sampleCount < inArray.total();
+    const cv::Mat countedArray = (isSampled)? HistogramBinning::sample(inArray, *sampling) : inArray;
+    countArray(countedArray, t_binSize, t_binStart, t_binEnd);
+
+    if(isSampled){
+        m_sampledSize = inArray.size();
+        m_confidenceIntervals = HistogramBinning::confidenceIntervals(m_histogram.toVector(), countedArray.total(), inArray.total());
+
+        // Scale the counts of the sample up to the size of the array
+        const double scale = static_cast<double>(inArray.total()) / countedArray.total();
+        const auto lambda_scaleCount = [scale](const size_t count) -> size_t {return static_cast<size_t>(std::llround(count * scale)); };
+        for(size_t i = 0; i < m_histogram.size(); i++){
+            m_histogram.set(i, lambda_scaleCount(m_histogram[i]));
+        }
+        m_outOfRangeCount = lambda_scaleCount(m_outOfRangeCount);
+        m_nanCount = lambda_scaleCount(m_nanCount);
+    }
+}
+
+void Histogram::refine(const cv::Mat &inArray)
+{
+    if(!isApproximate())
+        return;
+
+    if(inArray.size() != m_sampledSize){
+        throw(std::invalid_argument("Refined array should have the size of the sampled array"));
+    }
+
+    // The bins are kept, only the approximate counts are replaced
+    countArray(inArray, static_cast<int>(m_binRange->binCount), m_binRange->binStart, m_binRange->binEnd);
+    m_sampledSize = cv::Size();
+    m_confidenceIntervals.clear();
+    markModified();
+}
+
+Histogram Histogram::perChannel(const cv::Mat &inArray, const std::optional<int> binSize, const std::optional<float> binStart, const std::optional<float> binEnd)
+{
+    if(binSize && *binSize == 0){
+        throw(std::invalid_argument("number of bins cannot be zero"));
+    }
+
+    // Every channel shares the same bins, so the range covers the extremes of all of the channels
+    const std::pair<double, double> extremes = (!binStart || !binEnd)? HistogramBinning::minMax(inArray) : std::pair<double, double>{};
+    const HistogramBinning::BinRange range = HistogramBinning::resolveBinRange(extremes, binSize, binStart, binEnd);
+
+    // All of the channels are counted with a single pass over the interleaved pixels
+    HistogramBinning::RejectedValues rejected;
+    std::vector<std::vector<size_t>> channelCounts = HistogramBinning::countChannels(inArray, range.binCount, range.binStart, range.binEnd, 0, &rejected);
+
+    Histogram histogram(std::move(channelCounts.front()), range.binStart, range.binEnd);
+    for(auto it_channel = channelCounts.begin() + 1; it_channel != channelCounts.end(); it_channel++){
+        histogram.m_additionalSeries.emplace_back(std::move(*it_channel));
+    }
+    histogram.m_outOfRangeCount = rejected.outOfRange;
+    histogram.m_nanCount = rejected.nan;
+
+    return histogram;
+}
+
+Histogram Histogram::fromSelection(const cv::Mat &inArray, const HistogramBinning::PixelSelection &selection, const std::optional<int> binSize,
+                                   const std::optional<float> binStart, const std::optional<float> binEnd)
+{
+    if(binSize && *binSize == 0){
+        throw(std::invalid_argument("number of bins cannot be zero"));
+    }
+
+    // Only the selected pixels determine the missing boundaries
+    const std::pair<double, double> extremes = (!binStart || !binEnd)? HistogramBinning::minMax(inArray, selection) : std::pair<double, double>{};
+    const HistogramBinning::BinRange range = HistogramBinning::resolveBinRange(extremes, binSize, binStart, binEnd);
+
+    HistogramBinning::RejectedValues rejected;
+    std::vector<size_t> counts;
+    if(selection.weights.empty()){
+        counts = HistogramBinning::countBins(inArray, selection, range.binCount, range.binStart, range.binEnd, 0, &rejected);
+    }
+    else{
+        // Negative sums are drawn as empty bins
+        const std::vector<double> weightedCounts = HistogramBinning::countWeightedBins(inArray, selection, range.binCount, range.binStart, range.binEnd, 0, &rejected);
+        counts.reserve(weightedCounts.size());
+        for(const double weightedCount : weightedCounts){
+            counts.push_back(static_cast<size_t>(std::llround(std::max(weightedCount, 0.0))));
+        }
+    }
+
+    Histogram histogram(std::move(counts), range.binStart, range.binEnd);
+    histogram.m_outOfRangeCount = rejected.outOfRange;
+    histogram.m_nanCount = rejected.nan;
+
+    return histogram;
+}
+
+const HistogramCounts &Histogram::getCounts(const size_t series) const
+{
+    if(series >= getSeriesCount()){
+        throw(std::out_of_range("Histogram doesn't have the requested series"));
+    }
+
+    return seriesCounts(series);
+}
+
+void Histogram::setCountWidth(const CountWidth width)
+{
+    //Only a change of the requested width or of the stored representation is a modification
+    bool isModified = (m_countWidth != width);
+    m_countWidth = width;
+
+    const auto lambda_setWidth = [width, &isModified](HistogramCounts& counts){
+        const CountWidth previousWidth = counts.width();
+        counts.setWidth(width);
+        isModified |= (counts.width() != previousWidth);
+    };
+    lambda_setWidth(m_histogram);
+    for(HistogramCounts& counts : m_additionalSeries){
+        lambda_setWidth(counts);
+    }
+
+    if(isModified){
+        markModified();
+    }
+}
+
+void Histogram::setSeriesLayout(const SeriesLayout layout)
+{
+    if(m_seriesLayout != layout){
+        m_seriesLayout = layout;
+        markModified();
+    }
+}
+
+void Histogram::countArray(const cv::Mat &inArray, const std::optional<int> t_binSize, const std::optional<float> t_binStart, const std::optional<float> t_binEnd)
+{
+    // 8-bit and 16-bit unsigned arrays are counted once into a table of every possible value. Both the range and the bins are derived from the table
+    const std::vector<size_t> valueCounts = (HistogramBinning::supportsValueCounts(inArray))? HistogramBinning::valueCounts(inArray) : std::vector<size_t>{};
+
+    // At least one of the range parameters isn't nullopt so auto-range will be necessary. The table only holds the first channel, so the extremes of the
+    // other channels still require a pass over the array
     double minVal{};
     double maxVal{};
     if((!t_binStart) || (!t_binEnd)){
-        cv::minMaxLoc(inArray, &minVal, &maxVal, nullptr, nullptr);
+        std::tie(minVal, maxVal) = (!valueCounts.empty() && inArray.channels() == 1)? HistogramBinning::minMax(valueCounts) : HistogramBinning::minMax(inArray);
     }
 
-    // This lambda expression extends the min-max value for padding
-    constexpr float HISTOGRAM_AXES_PADDING_PERCENTAGE = 0.05F;
-    const auto lambda_addLeftPadding = [=](float value) -> float {return (value > 0)? value * (1 - HISTOGRAM_AXES_PADDING_PERCENTAGE) : value * (1 + HISTOGRAM_AXES_PADDING_PERCENTAGE); };
-    const auto lambda_addRightPaddng = [=](float value) -> float {return (value > 0)? value * (1 + HISTOGRAM_AXES_PADDING_PERCENTAGE) : value * (1 - HISTOGRAM_AXES_PADDING_PERCENTAGE); };
+    // Complete the missing bin parameters
+    const HistogramBinning::BinRange range = HistogramBinning::resolveBinRange({minVal, maxVal}, t_binSize, t_binStart, t_binEnd);
+
+    // Count the first channel of the array into uniform bins, stripes of the array are counted concurrently. Values outside of the range and NaN values are tallied
+    HistogramBinning::RejectedValues rejected;
+    std::vector<size_t> counts = (valueCounts.empty())? HistogramBinning::countBins(inArray, range.binCount, range.binStart, range.binEnd, 0, &rejected) :
+                                                        HistogramBinning::foldValueCounts(valueCounts, range.binCount, range.binStart, range.binEnd, &rejected);
+    m_histogram = HistogramCounts(std::move(counts), m_countWidth);
+    m_outOfRangeCount = rejected.outOfRange;
+    m_nanCount = rejected.nan;
+    m_bins = BinsView(range.binStart, range.binEnd, range.binCount);
+    m_binRange = range;
+}
 
-    // Determine the ranges
-    const float binStart = t_binStart.value_or(lambda_addLeftPadding(minVal));
-    const float binEnd = (t_binEnd).value_or(lambda_addRightPaddng(maxVal));
-    const int binSize = (t_binSize).value_or( binEnd - binStart + 1);
+void Histogram::setBinAggregation(const BinAggregation aggregation)
+{
+    if(m_binAggregation != aggregation){
+        m_binAggregation = aggregation;
+        markModified();
+    }
+}
 
-    // Apply OpenCV histogram calculation
-    cv::Mat hist;
-    const std::vector ranges = {binStart, binEnd};
-    const std::vector bins{binSize};
-    std::vector<cv::Mat>vMat{inArray};
-    std::vector<int> chs{0};  
-    cv::calcHist(vMat, chs, cv::Mat(), hist, bins, ranges, true);
+void Histogram::accumulate(const cv::Mat &frame)
+{
+    if(getSeriesCount() > 1){
+        throw(std::runtime_error("Frames can only be accumulated into single series histograms"));
+    }
+    if(isApproximate()){
+        throw(std::runtime_error("Approximate histogram should be refined before frames are accumulated"));
+    }
+    if(!m_binRange){
+        throw(std::runtime_error("Frames can only be accumulated into histograms with uniform bins"));
+    }
+
+    if(m_decayFactor < 1.0){
+        //Scale the previous counts down before the frame is added
+        const FrameCounts frameCounts = countFrame(frame);
+        for(size_t i = 0; i < m_histogram.size(); i++){
+            m_decayedCounts[i] = (m_decayedCounts[i] * m_decayFactor) + frameCounts.counts[i];
+            m_histogram.set(i, static_cast<size_t>(std::llround(m_decayedCounts[i])));
+        }
+
+        m_decayedOutOfRangeCount = (m_decayedOutOfRangeCount * m_decayFactor) + frameCounts.outOfRangeCount;
+        m_decayedNanCount = (m_decayedNanCount * m_decayFactor) + frameCounts.nanCount;
+        m_outOfRangeCount = static_cast<size_t>(std::llround(m_decayedOutOfRangeCount));
+        m_nanCount = static_cast<size_t>(std::llround(m_decayedNanCount));
+    }
+    else if(m_windowLength > 0){
+        //The frame is counted before anything is changed, so that an invalid frame leaves the window intact
+        FrameCounts frameCounts = countFrame(frame);
+        if(m_windowFrames.size() == m_windowLength){
+            removeFrame(m_windowFrames.front());
+            m_windowFrames.pop_front();
+        }
+
+        m_histogram.add(frameCounts.counts);
+        m_outOfRangeCount += frameCounts.outOfRangeCount;
+        m_nanCount += frameCounts.nanCount;
+        m_windowFrames.push_back(std::move(frameCounts));
+    }
+    else{
+        //Nothing has to be remembered about the frame, so it is counted directly into 64-bit counts. Narrow counts take the counts of the frame
+        //as a sum, which widens them if needed
+        HistogramBinning::RejectedValues rejected;
+        if(std::vector<size_t>* counts = m_histogram.wideCounts()){
+            HistogramBinning::accumulateCounts(frame, m_binRange->binStart, m_binRange->binEnd, *counts, 0, &rejected);
+        }
+        else{
+            m_histogram.add(HistogramBinning::countBins(frame, m_binRange->binCount, m_binRange->binStart, m_binRange->binEnd, 0, &rejected));
+        }
+        m_outOfRangeCount += rejected.outOfRange;
+        m_nanCount += rejected.nan;
+    }
+
+    markModified();
+}
+
+void Histogram::subtract(const cv::Mat &frame)
+{
+    if(getSeriesCount() > 1){
+        throw(std::runtime_error("Frames can only be subtracted from single series histograms"));
+    }
+    if(isApproximate()){
+        throw(std::runtime_error("Approximate histogram should be refined before frames are subtracted"));
+    }
+    if(!m_binRange){
+        throw(std::runtime_error("Frames can only be subtracted from histograms with uniform bins"));
+    }
+    if(m_windowLength > 0 || m_decayFactor < 1.0){
+        throw(std::runtime_error("Frames cannot be subtracted while the histogram forgets its frames"));
+    }
+
+    //Every count is checked beforehand, so that a frame which hasn't been accumulated leaves the counts intact
+    const FrameCounts frameCounts = countFrame(frame);
+    const bool isContained = std::equal(m_histogram.begin(), m_histogram.end(), frameCounts.counts.begin(), std::greater_equal<size_t>()) &&
+                             m_outOfRangeCount >= frameCounts.outOfRangeCount && m_nanCount >= frameCounts.nanCount;
+    if(!isContained){
+        throw(std::invalid_argument("Subtracted frame has more values than the histogram"));
+    }
 
-    m_histogram = std::vector<size_t>(hist.begin<float>(), hist.end<float>());
-    m_bins = PlotUtils::linspace(binStart, binEnd, binSize);
+    removeFrame(frameCounts);
+    markModified();
+}
+
+void Histogram::setSlidingWindow(const size_t frames)
+{
+    if(frames > 0 && m_decayFactor < 1.0){
+        throw(std::invalid_argument("Sliding window cannot be used together with decay"));
+    }
+
+    //Frames beyond the new length leave the window. Disabling the window keeps the counts of its frames permanently
+    m_windowLength = frames;
+    while(m_windowFrames.size() > m_windowLength && m_windowLength > 0){
+        removeFrame(m_windowFrames.front());
+        m_windowFrames.pop_front();
+        markModified();
+    }
+
+    if(m_windowLength == 0)
+        m_windowFrames.clear();
+}
+
+void Histogram::setDecayFactor(const double factor)
+{
+    if(!(factor >= 0.0 && factor <= 1.0)){
+        throw(std::invalid_argument("Decay factor should be between 0 and 1"));
+    }
+    if(factor < 1.0 && m_windowLength > 0){
+        throw(std::invalid_argument("Decay cannot be used together with sliding window"));
+    }
+
+    //Decay starts from the current counts, disabling it keeps the rounded counts
+    if(factor < 1.0 && m_decayFactor == 1.0){
+        m_decayedCounts.assign(m_histogram.begin(), m_histogram.end());
+        m_decayedOutOfRangeCount = static_cast<double>(m_outOfRangeCount);
+        m_decayedNanCount = static_cast<double>(m_nanCount);
+    }
+    else if(factor == 1.0){
+        m_decayedCounts.clear();
+    }
+
+    m_decayFactor = factor;
+}
+
+void Histogram::resetCounts()
+{
+    //Zero counts fit into any width, so counts that have been widened return to the requested width. Every series is reset
+    m_histogram.fill(0);
+    m_histogram.setWidth(m_countWidth);
+    for(HistogramCounts& counts : m_additionalSeries){
+        counts.fill(0);
+        counts.setWidth(m_countWidth);
+    }
+    std::fill(m_decayedCounts.begin(), m_decayedCounts.end(), 0.0);
+    m_windowFrames.clear();
+    m_outOfRangeCount = 0;
+    m_nanCount = 0;
+    m_decayedOutOfRangeCount = 0;
+    m_decayedNanCount = 0;
+
+    markModified();
+}
+
+Histogram::FrameCounts Histogram::countFrame(const cv::Mat &frame) const
+{
+    HistogramBinning::RejectedValues rejected;
+    FrameCounts frameCounts;
+    frameCounts.counts = HistogramBinning::countBins(frame, m_binRange->binCount, m_binRange->binStart, m_binRange->binEnd, 0, &rejected);
+    frameCounts.outOfRangeCount = rejected.outOfRange;
+    frameCounts.nanCount = rejected.nan;
+
+    return frameCounts;
+}
+
+void Histogram::removeFrame(const FrameCounts &frameCounts)
+{
+    m_histogram.subtract(frameCounts.counts);
+    m_outOfRangeCount -= frameCounts.outOfRangeCount;
+    m_nanCount -= frameCounts.nanCount;
 }
 
 cv::Mat Histogram::generate()
+{
+    //Nothing has changed since the last render
+    if(isCanvasUpToDate(revision()))
+        return m_canvas;
+
+    //Each render provides a new canvas, so that the previously returned canvases stay intact. Only the canvases that the element has
+    //allocated are kept, the buffers of the callers can be modified by them at any time
+    cv::Mat out;
+    generate(out);
+    m_canvas = out;
+    markRendered(revision());
+    return out;
+}
+
+void Histogram::generate(cv::Mat &out)
 {
     if(!m_histogram.size() || !m_bins.size())
         throw(std::runtime_error("Length of the histogram or bins vector cannot be zero"));
 
-    //Generate the title and x-axis text beforehand.
-    cv::Mat titleCanvas = (m_title.empty())? cv::Mat() : generateText(m_titleSize, m_title, m_titleColor);
-    cv::Mat xAxisCanvas = (m_xAxisText.empty())? cv::Mat() : generateText(m_xAxisSize, m_xAxisText, m_xAxisColor);
+    //Measure the title and x-axis text beforehand. They will be rendered once they are placed
+    const cv::Size titleCanvasSize = (m_title.empty())? cv::Size() : measureText(m_titleSize, m_title);
+    const cv::Size xAxisCanvasSize = (m_xAxisText.empty())? cv::Size() : measureText(m_xAxisSize, m_xAxisText);
 
     //There is a lower limit on the sizes that a canvas can have
-    const auto minimumCanvasSize = calculateMinimumCanvasSize(titleCanvas.size(), xAxisCanvas.size());
+    const auto minimumCanvasSize = calculateMinimumCanvasSize(titleCanvasSize, xAxisCanvasSize);
     canvasSize.height = std::max(canvasSize.height, minimumCanvasSize.height);
     canvasSize.width = std::max(canvasSize.width, minimumCanvasSize.width);
 
-    //Generate a blank canvas
-    m_canvas = cv::Mat(canvasSize, CV_8UC3, white);
+    //Prepare a blank canvas on the caller's buffer
+    prepareCanvas(out);
 
     //This counter keeps track of the last row position on the canvas
     int canvasRowCounter = 0;
@@ -132,29 +454,36 @@ cv::Mat Histogram::generate()
     //Add top padding to the row counter
     canvasRowCounter += CANVAS_HEIGHT_PADDING;
 
-    //Reshape the previously generated title and place it on the canvas
-    if (!titleCanvas.empty()) {
-        centerElement(titleCanvas, cv::Size{canvasSize.width, 0}, AlignmentType::WidthOnly);
-        titleCanvas.copyTo(m_canvas(cv::Rect(0, canvasRowCounter, titleCanvas.cols, titleCanvas.rows)));
+    //Render the title and place it on the canvas
+    if (!m_title.empty()) {
+        const cv::Mat titleCanvas = generateText(m_titleSize, m_title, m_titleColor);
+        placeElement(titleCanvas, out, cv::Rect(0, canvasRowCounter, canvasSize.width, titleCanvas.rows), AlignmentType::WidthOnly);
 
         canvasRowCounter += titleCanvas.rows + PADDING_TITLE_HISTOGRAM;
     }
 
-    //Generate the histogram and place it on canvas
-    cv::Mat histogramCanvas = generateHistogramCanvas(titleCanvas.rows, xAxisCanvas.rows);
-    centerElement(histogramCanvas, cv::Size{canvasSize.width, 0}, AlignmentType::WidthOnly);
-    histogramCanvas.copyTo(m_canvas(cv::Rect(0, canvasRowCounter, histogramCanvas.cols, histogramCanvas.rows)));
+    //Draw the histogram directly on its area of the canvas
+    const int histogramWidth = canvasSize.width - (2 * CANVAS_WIDTH_PADDING) - yAxisTextWidth();
+    const int histogramHeight = canvasSize.height - totalHeightPadding() - titleCanvasSize.height - xAxisTextHeight() - xAxisCanvasSize.height;
+    cv::Mat histogramArea = out(cv::Rect(CANVAS_WIDTH_PADDING, canvasRowCounter, histogramWidth + yAxisTextWidth(), histogramHeight + xAxisTextHeight()));
+    drawHistogramCanvas(histogramArea);
 
-    canvasRowCounter += histogramCanvas.rows + PADDING_HISTOGRAM_XAXIS;
+    canvasRowCounter += histogramArea.rows + PADDING_HISTOGRAM_XAXIS;
 
-    //Place the x-axis text that previously generated
-    if (!xAxisCanvas.empty()) {
-        centerElement(xAxisCanvas, cv::Size{canvasSize.width, 0}, AlignmentType::WidthOnly);
-        xAxisCanvas.copyTo(m_canvas(cv::Rect(0, canvasRowCounter, xAxisCanvas.cols, xAxisCanvas.rows)));
+    //Render the x-axis text and place it on the canvas
+    if (!m_xAxisText.empty()) {
+        const cv::Mat xAxisCanvas = generateText(m_xAxisSize, m_xAxisText, m_xAxisColor);
+        placeElement(xAxisCanvas, out, cv::Rect(0, canvasRowCounter, canvasSize.width, xAxisCanvas.rows), AlignmentType::WidthOnly);
     }
+}
 
-    //Generate the histogram graph element.
-    return m_canvas;
+cv::Size Histogram::requiredCanvasSize()
+{
+    const cv::Size titleCanvasSize = (m_title.empty())? cv::Size() : measureText(m_titleSize, m_title);
+    const cv::Size xAxisCanvasSize = (m_xAxisText.empty())? cv::Size() : measureText(m_xAxisSize, m_xAxisText);
+    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvasSize, xAxisCanvasSize);
+
+    return cv::Size{std::max(canvasSize.width, minimumCanvasSize.width), std::max(canvasSize.height, minimumCanvasSize.height)};
 }
 
 cv::Size Histogram::calculateMinimumCanvasSize(const cv::Size& titleCanvasSize, const cv::Size& xAxisCanvasSize)
@@ -163,7 +492,12 @@ cv::Size Histogram::calculateMinimumCanvasSize(const cv::Size& titleCanvasSize,
     m_xAxisTextSize = allocateNumericTextSpace(DEFAULT_AXIS_NUMBER_SIZE, 1.25, m_precision_x);
     m_yAxisTextSize = allocateNumericTextSpace(DEFAULT_AXIS_NUMBER_SIZE, 1.25, m_precision_y);
 
-    const cv::Size minimumHistogramSize{static_cast<int>(m_bins.size()), MINIMUM_HISTOGRAM_HEIGHT};
+    //Aggregated bins don't require a pixel column each.
+    //Side by side series require a pixel column per series within each bin
+    const int columnsPerBin = (m_seriesLayout == SeriesLayout::SideBySide)? static_cast<int>(getSeriesCount()) : 1;
+    const int minimumHistogramWidth = (m_binAggregation == BinAggregation::None)? static_cast<int>(m_bins.size()) * columnsPerBin :
+                                                                                  std::min(static_cast<int>(m_bins.size()), MINIMUM_AGGREGATED_HISTOGRAM_WIDTH);
+    const cv::Size minimumHistogramSize{minimumHistogramWidth, MINIMUM_HISTOGRAM_HEIGHT};
     const int histogramWidthWithyAxis = minimumHistogramSize.width + m_yAxisTextSize.width;
 
     //Combine minimum sizes
@@ -175,24 +509,32 @@ cv::Size Histogram::calculateMinimumCanvasSize(const cv::Size& titleCanvasSize,
     return cv::Size{totalWidth, totalHeight};
 }
 
-cv::Mat Histogram::generateHistogramCanvas(const int titleCanvasHeight, const int xAxisCanvasHeight)
+void Histogram::drawHistogramCanvas(cv::Mat &out) const
 {
-    //Create a histogram canvas with proper paddings
-    const auto& [canvasWidth, canvasHeight] = m_canvas.size();
-    const int histogramWidth = canvasWidth - (2 * CANVAS_WIDTH_PADDING) - yAxisTextWidth();
-    const int histogramHeight = canvasHeight - totalHeightPadding() - titleCanvasHeight - xAxisTextHeight() - xAxisCanvasHeight;
-    cv::Mat out(histogramHeight + xAxisTextHeight(), histogramWidth + yAxisTextWidth(), CV_8UC3, white);
+    //Separate the histogram area from the axis text areas
+    const int histogramWidth = out.cols - yAxisTextWidth();
+    const int histogramHeight = out.rows - xAxisTextHeight();
+
+    //Bins that cannot get a pixel column each are aggregated per pixel column
+    if(m_binAggregation != BinAggregation::None && m_bins.size() > static_cast<size_t>(histogramWidth)){
+        drawAggregatedHistogramCanvas(out);
+        return;
+    }
+
     cv::Mat histogramCanvas = out(cv::Rect(yAxisTextWidth(), 0, histogramWidth, histogramHeight));
 
     //Draw a rectangle around histogram to indicate the area
     cv::rectangle(histogramCanvas, cv::Rect(0, 0, histogramCanvas.cols, histogramCanvas.rows), black, 1, cv::LINE_AA);
 
-    //Normalize histogram values to fit the histogram canvas
-    constexpr double PADDING_MAX_HEIGHT_PERCENTAGE = 0.95;
-    const size_t maxCount = *std::max_element(m_histogram.begin(), m_histogram.end());
+    //Normalize histogram values to fit the histogram canvas, every series has the same scale
+    //An empty accumulator has no counts at all, its bins are drawn flat
+    const size_t seriesCount = getSeriesCount();
+    size_t maxCount = 1;
+    for(size_t series = 0; series < seriesCount; series++){
+        maxCount = std::max(maxCount, seriesCounts(series).max());
+    }
     const int histogramHeight_padded = histogramHeight * PADDING_MAX_HEIGHT_PERCENTAGE;
     const auto lambda_normalizeBinHeight = [maxCount, histogramHeight_padded](const size_t curHistogram) -> int { return static_cast<int>(histogramHeight_padded * curHistogram / maxCount); };
-    const std::vector<int> histogram_normalized = PlotUtils::vector_comprehension(m_histogram.cbegin(), m_histogram.cend(), lambda_normalizeBinHeight);
 
     //Determine the range of each bin
     const int binPixelWidth = histogramWidth / m_bins.size();
@@ -202,10 +544,33 @@ cv::Mat Histogram::generateHistogramCanvas(const int titleCanvasHeight, const in
     const int binsStartPixel = (histogramWidth - (binPixelWidth * m_bins.size())) / 2;
     int binPixelCounter = binsStartPixel;
 
-    for(const int currentHistogram: histogram_normalized){
-        //Define a rectangle that represents the location of the current bin and paint it black
-        const cv::Rect binArea(binPixelCounter, histogramHeight - currentHistogram, binPixelWidth, currentHistogram);
-        histogramCanvas(binArea).setTo(black);
+    //Side by side series split the width of each bin. Overlaid series are drawn from the highest to the lowest bar, so the top of every bar stays visible
+    const int seriesPixelWidth = (m_seriesLayout == SeriesLayout::SideBySide)? binPixelWidth / static_cast<int>(seriesCount) : binPixelWidth;
+    std::vector<size_t> drawOrder((seriesCount > 1)? seriesCount : 0);
+
+    const auto lambda_drawBar = [&](const int x, const int width, const size_t count, const cv::Scalar& color){
+        const int barHeight = lambda_normalizeBinHeight(count);
+        cv::Mat binCanvas = histogramCanvas(cv::Rect(x, histogramHeight - barHeight, width, barHeight));
+        fillArea(binCanvas, color);
+    };
+
+    for(size_t bin = 0; bin < m_bins.size(); bin++){
+        if(seriesCount == 1){
+            //Define a rectangle that represents the location of the current bin and paint it black
+            lambda_drawBar(binPixelCounter, binPixelWidth, m_histogram[bin], black);
+        }
+        else if(m_seriesLayout == SeriesLayout::SideBySide){
+            for(size_t series = 0; series < seriesCount; series++){
+                lambda_drawBar(binPixelCounter + (static_cast<int>(series) * seriesPixelWidth), seriesPixelWidth, seriesCounts(series)[bin], seriesColor(series));
+            }
+        }
+        else{
+            std::iota(drawOrder.begin(), drawOrder.end(), 0);
+            std::sort(drawOrder.begin(), drawOrder.end(), [&](const size_t lhs, const size_t rhs){ return seriesCounts(lhs)[bin] > seriesCounts(rhs)[bin]; });
+            for(const size_t series : drawOrder){
+                lambda_drawBar(binPixelCounter, binPixelWidth, seriesCounts(series)[bin], seriesColor(series));
+            }
+        }
 
         // Increment counter to place next bin
         binPixelCounter += binPixelWidth;
@@ -214,8 +579,93 @@ cv::Mat Histogram::generateHistogramCanvas(const int titleCanvasHeight, const in
     //Prepare the axis numbers
     const int yAxisStartPixel = histogramHeight - histogramHeight_padded;
     addAxis(out, { binsStartPixel, binsStartPixel }, { yAxisStartPixel, 0 }, { *m_bins.cbegin(), *(m_bins.cend() - 1) }, { 0, maxCount });
+}
 
-    return out;
+void Histogram::drawAggregatedHistogramCanvas(cv::Mat &out) const
+{
+    //Separate the histogram area from the axis text areas
+    const int histogramWidth = out.cols - yAxisTextWidth();
+    const int histogramHeight = out.rows - xAxisTextHeight();
+    cv::Mat histogramCanvas = out(cv::Rect(yAxisTextWidth(), 0, histogramWidth, histogramHeight));
+
+    //Draw a rectangle around histogram to indicate the area
+    cv::rectangle(histogramCanvas, cv::Rect(0, 0, histogramCanvas.cols, histogramCanvas.rows), black, 1, cv::LINE_AA);
+
+    //Each pixel column covers a contiguous run of bins, the runs of adjacent columns differ by one bin at most.
+    //Returns the count that every bin of the run reaches and the highest count of the run
+    const auto lambda_aggregateColumn = [&](const HistogramCounts& counts, const int column) -> std::pair<size_t, size_t> {
+        const auto first = counts.cbegin() + (column * counts.size() / histogramWidth);
+        const auto last = counts.cbegin() + ((column + 1) * counts.size() / histogramWidth);
+        switch (m_binAggregation) {
+        case BinAggregation::Sum: {
+            const size_t sum = std::accumulate(first, last, size_t{0});
+            return {sum, sum};
+        }
+        case BinAggregation::MinMaxEnvelope: {
+            const auto[minCount, maxCount] = std::minmax_element(first, last);
+            return {*minCount, *maxCount};
+        }
+        default: {
+            const size_t maxCount = *std::max_element(first, last);
+            return {maxCount, maxCount};
+        }
+        }
+    };
+
+    //The first pass over the columns finds the scale of the bars, the second one draws them. Nothing is stored per bin or per column
+    const size_t seriesCount = getSeriesCount();
+    size_t maxCount = 1;
+    for(size_t series = 0; series < seriesCount; series++){
+        for(int column = 0; column < histogramWidth; column++){
+            maxCount = std::max(maxCount, lambda_aggregateColumn(seriesCounts(series), column).second);
+        }
+    }
+
+    const int histogramHeight_padded = histogramHeight * PADDING_MAX_HEIGHT_PERCENTAGE;
+    const auto lambda_normalizeBinHeight = [maxCount, histogramHeight_padded](const size_t curHistogram) -> int { return static_cast<int>(histogramHeight_padded * curHistogram / maxCount); };
+
+    //A pixel column cannot be split, so multiple series are always overlaid from the highest to the lowest bar
+    std::vector<std::pair<size_t, size_t>> seriesHighCounts((seriesCount > 1)? seriesCount : 0);
+    for(int column = 0; column < histogramWidth; column++){
+        if(seriesCount == 1){
+            //The part that every bin of the column reaches is black, the envelope above it is gray
+            const auto[lowCount, highCount] = lambda_aggregateColumn(m_histogram, column);
+            const int lowHeight = lambda_normalizeBinHeight(lowCount);
+            const int highHeight = lambda_normalizeBinHeight(highCount);
+
+            cv::Mat barCanvas = histogramCanvas(cv::Rect(column, histogramHeight - lowHeight, 1, lowHeight));
+            fillArea(barCanvas, black);
+            cv::Mat envelopeCanvas = histogramCanvas(cv::Rect(column, histogramHeight - highHeight, 1, highHeight - lowHeight));
+            fillArea(envelopeCanvas, gray);
+            continue;
+        }
+
+        for(size_t series = 0; series < seriesCount; series++){
+            seriesHighCounts[series] = {lambda_aggregateColumn(seriesCounts(series), column).second, series};
+        }
+        std::sort(seriesHighCounts.begin(), seriesHighCounts.end(), std::greater<std::pair<size_t, size_t>>());
+        for(const auto&[highCount, series] : seriesHighCounts){
+            const int highHeight = lambda_normalizeBinHeight(highCount);
+            cv::Mat barCanvas = histogramCanvas(cv::Rect(column, histogramHeight - highHeight, 1, highHeight));
+            fillArea(barCanvas, seriesColor(series));
+        }
+    }
+
+    //Prepare the axis numbers
+    const int yAxisStartPixel = histogramHeight - histogramHeight_padded;
+    addAxis(out, { 0, 0 }, { yAxisStartPixel, 0 }, { *m_bins.cbegin(), *(m_bins.cend() - 1) }, { 0, maxCount });
+}
+
+const HistogramCounts &Histogram::seriesCounts(const size_t series) const
+{
+    return (series == 0)? m_histogram : m_additionalSeries[series - 1];
+}
+
+cv::Scalar Histogram::seriesColor(const size_t series) const
+{
+    //Channels of BGR images are drawn with their own colors, a fourth channel is gray
+    const std::array<cv::Scalar, 4> seriesColors{blue, green, red, gray};
+    return (getSeriesCount() == 1)? black : seriesColors[series % seriesColors.size()];
 }
 
 int Histogram::totalHeightPadding() const
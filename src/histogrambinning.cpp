@@ -0,0 +1,747 @@
+#include "histogrambinning.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/version.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+//The vectorized bin mapping relies on the function style universal intrinsics of OpenCV 4.9 and needs double precision lanes
+#if (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 9)) && (CV_SIMD_64F || CV_SIMD_SCALABLE_64F)
+#define HISTOGRAMBINNING_SIMD 1
+#else
+#define HISTOGRAMBINNING_SIMD 0
+#endif
+
+
+namespace {
+    //Stripes smaller than this aren't worth being processed by a separate thread
+    constexpr size_t MINIMUM_VALUES_PER_STRIPE = 1 << 16;
+
+    //Number of adjacent pixels in a block of block sampling
+    constexpr size_t SAMPLING_BLOCK_LENGTH = 64;
+
+    //Uniform bin mapping of cv::calcHist. Bin index is floor(value * scale + offset), evaluated in double precision
+    struct BinMapping
+    {
+        BinMapping(const float binStart, const float binEnd, const size_t binCount) :
+            lower(binStart),
+            upper(binEnd),
+            scale(binCount / (static_cast<double>(binEnd) - binStart)),
+            offset(-scale * binStart),
+            lastBin(static_cast<int>(binCount) - 1)
+        {}
+
+        //Values outside of [lower, upper) aren't counted. NaN fails both comparisons, so it is rejected as well
+        bool contains(const double value) const { return value >= lower && value < upper; };
+        int index(const double value) const { return std::clamp(cvFloor((value * scale) + offset), 0, lastBin); };
+
+        double lower;
+        double upper;
+        double scale;
+        double offset;
+        int lastBin;
+    };
+
+    //Calls the functor with the type of the given depth
+    template<typename Functor>
+    void visitDepth(const int depth, Functor&& functor)
+    {
+        switch (depth) {
+        case CV_8U: functor(uint8_t{}); break;
+        case CV_8S: functor(int8_t{}); break;
+        case CV_16U: functor(uint16_t{}); break;
+        case CV_16S: functor(int16_t{}); break;
+        case CV_32S: functor(int32_t{}); break;
+        case CV_32F: functor(float{}); break;
+        case CV_64F: functor(double{}); break;
+        default: throw std::invalid_argument("Histogram binning doesn't support the depth of the array");
+        }
+    }
+
+    //Calls the functor with contiguous (data, number of pixels, row-major index of the first pixel) spans of the part of the array that belongs to the stripe.
+    //Continuous arrays are split evenly regardless of their shape, others are split by their rows
+    template<typename T, typename Functor>
+    void forEachSpan(const cv::Mat& input, const int stripe, const int stripeCount, Functor&& functor)
+    {
+        if(input.isContinuous()){
+            const size_t totalPixels = input.total();
+            const size_t begin = totalPixels * stripe / stripeCount;
+            const size_t end = totalPixels * (stripe + 1) / stripeCount;
+            functor(input.ptr<T>() + (begin * input.channels()), end - begin, begin);
+            return;
+        }
+
+        const int rowBegin = static_cast<int>(static_cast<int64_t>(input.rows) * stripe / stripeCount);
+        const int rowEnd = static_cast<int>(static_cast<int64_t>(input.rows) * (stripe + 1) / stripeCount);
+        for(int r = rowBegin; r < rowEnd; r++){
+            functor(input.ptr<T>(r), static_cast<size_t>(input.cols), static_cast<size_t>(r) * input.cols);
+        }
+    }
+
+    //Calls the functor with the runs of a span that the mask selects, along with the weights of the runs. The mask and the weights are arrays
+    //with the given number of columns, empty ones select every pixel and give no weights. A span of a continuous array may cross its rows,
+    //so the mask and the weights are addressed row by row and don't need to be continuous
+    template<typename T, typename Functor>
+    void forEachSelectedRun(const T* data, const size_t pixels, const size_t firstPixel, const int channels, const size_t columns, const cv::Mat& mask, const cv::Mat& weights,
+                            Functor&& functor)
+    {
+        for(size_t done = 0; done < pixels;){
+            const size_t pixel = firstPixel + done;
+            const int row = static_cast<int>(pixel / columns);
+            const size_t column = pixel % columns;
+            const size_t length = std::min(pixels - done, columns - column);
+
+            const T* rowData = data + (done * channels);
+            const float* rowWeights = (weights.empty())? nullptr : weights.ptr<float>(row) + column;
+            if(mask.empty()){
+                functor(rowData, length, rowWeights);
+            }
+            else{
+                const uchar* rowMask = mask.ptr<uchar>(row) + column;
+                for(size_t i = 0; i < length;){
+                    while(i < length && !rowMask[i])
+                        i++;
+                    const size_t runBegin = i;
+                    while(i < length && rowMask[i])
+                        i++;
+                    if(i > runBegin)
+                        functor(rowData + (runBegin * channels), i - runBegin, (rowWeights)? rowWeights + runBegin : nullptr);
+                }
+            }
+            done += length;
+        }
+    }
+
+    template<typename T>
+    void spanMinMax(const T* data, const size_t values, double& minValue, double& maxValue)
+    {
+        //Comparisons with NaN are always false, so NaN values never update the extremes
+        T curMin = std::numeric_limits<T>::max();
+        T curMax = std::numeric_limits<T>::lowest();
+        for(size_t i = 0; i < values; i++){
+            curMin = (data[i] < curMin)? data[i] : curMin;
+            curMax = (data[i] > curMax)? data[i] : curMax;
+        }
+
+        if(values && curMin <= curMax){
+            minValue = std::min(minValue, static_cast<double>(curMin));
+            maxValue = std::max(maxValue, static_cast<double>(curMax));
+        }
+    }
+
+    //Adds one to the bin of each counted pixel
+    struct UnitCounter
+    {
+        void add(const size_t, const int bin) const { counts[bin]++; };
+
+        size_t* counts;
+    };
+
+    //Adds the weight of each counted pixel to its bin. Weights are indexed by the pixel index within the span
+    struct WeightedCounter
+    {
+        void add(const size_t pixel, const int bin) const { counts[bin] += weights[pixel]; };
+
+        double* counts;
+        const float* weights;
+    };
+
+    void rejectValue(const double value, HistogramBinning::RejectedValues& rejected)
+    {
+        if(std::isnan(value))
+            rejected.nan++;
+        else
+            rejected.outOfRange++;
+    }
+
+#if HISTOGRAMBINNING_SIMD
+    //BinMapping broadcast to every lane. Bin positions are clamped before they are floored, so that infinite and huge values
+    //cannot overflow the integer conversion. Flooring and clamping commute for integer bounds, so the indices equal BinMapping::index
+    struct VectorBinMapping
+    {
+        explicit VectorBinMapping(const BinMapping& mapping) :
+            lower(cv::vx_setall_f64(mapping.lower)),
+            upper(cv::vx_setall_f64(mapping.upper)),
+            scale(cv::vx_setall_f64(mapping.scale)),
+            offset(cv::vx_setall_f64(mapping.offset)),
+            firstBin(cv::vx_setall_f64(0.0)),
+            lastBin(cv::vx_setall_f64(mapping.lastBin))
+        {}
+
+        //Counts the lanes that are loaded from "source", the first lane is the pixel "firstPixel" of the span. Multiplication and addition are kept separate,
+        //a fused multiply-add would round differently than cv::calcHist
+        template<typename T, typename Counter>
+        void count(const cv::v_float64& values, const T* source, const size_t firstPixel, const Counter& counter, HistogramBinning::RejectedValues& rejected) const
+        {
+            const int inRange = cv::v_signmask(cv::v_and(cv::v_ge(values, lower), cv::v_lt(values, upper)));
+            const cv::v_float64 position = cv::v_min(cv::v_max(cv::v_add(cv::v_mul(values, scale), offset), firstBin), lastBin);
+
+            int indices[cv::VTraits<cv::v_int32>::max_nlanes];
+            cv::v_store(indices, cv::v_floor(position));
+
+            const int lanes = cv::VTraits<cv::v_float64>::vlanes();
+            for(int lane = 0; lane < lanes; lane++){
+                if(inRange & (1 << lane))
+                    counter.add(firstPixel + lane, indices[lane]);
+                else
+                    rejectValue(source[lane], rejected);
+            }
+        }
+
+        cv::v_float64 lower;
+        cv::v_float64 upper;
+        cv::v_float64 scale;
+        cv::v_float64 offset;
+        cv::v_float64 firstBin;
+        cv::v_float64 lastBin;
+    };
+
+    //Counts the leading part of a single channel span with vector lanes and returns the number of values that have been counted
+    template<typename Counter>
+    size_t vectorSpanCounts(const float* data, const size_t values, const BinMapping& mapping, const Counter& counter, HistogramBinning::RejectedValues& rejected)
+    {
+        const VectorBinMapping vectorMapping(mapping);
+        const size_t step = cv::VTraits<cv::v_float32>::vlanes();
+        const size_t halfStep = cv::VTraits<cv::v_float64>::vlanes();
+
+        size_t i = 0;
+        for(; i + step <= values; i += step){
+            const cv::v_float32 loaded = cv::vx_load(data + i);
+            vectorMapping.count(cv::v_cvt_f64(loaded), data + i, i, counter, rejected);
+            vectorMapping.count(cv::v_cvt_f64_high(loaded), data + i + halfStep, i + halfStep, counter, rejected);
+        }
+        cv::vx_cleanup();
+        return i;
+    }
+
+    template<typename Counter>
+    size_t vectorSpanCounts(const double* data, const size_t values, const BinMapping& mapping, const Counter& counter, HistogramBinning::RejectedValues& rejected)
+    {
+        const VectorBinMapping vectorMapping(mapping);
+        const size_t step = cv::VTraits<cv::v_float64>::vlanes();
+
+        size_t i = 0;
+        for(; i + step <= values; i += step){
+            vectorMapping.count(cv::vx_load(data + i), data + i, i, counter, rejected);
+        }
+        cv::vx_cleanup();
+        return i;
+    }
+#endif
+
+    template<typename T, typename Counter>
+    void spanCounts(const T* data, const size_t pixels, const int channels, const BinMapping& mapping, const Counter& counter, HistogramBinning::RejectedValues& rejected)
+    {
+        size_t i = 0;
+#if HISTOGRAMBINNING_SIMD
+        //Floating point values of single channel arrays are mapped by vector lanes, the remainder is mapped one by one
+        if constexpr (std::is_floating_point_v<T>){
+            if(channels == 1)
+                i = vectorSpanCounts(data, pixels, mapping, counter, rejected);
+        }
+#endif
+        for(; i < pixels; i++){
+            const double value = data[i * channels];
+            if(mapping.contains(value))
+                counter.add(i, mapping.index(value));
+            else
+                rejectValue(value, rejected);
+        }
+    }
+
+    //Counts every channel of the interleaved pixels, so that the pixels are read once. Bins of the channel c start at c * (mapping.lastBin + 1)
+    template<typename T>
+    void spanChannelCounts(const T* data, const size_t pixels, const int channels, const BinMapping& mapping, size_t* counts, HistogramBinning::RejectedValues& rejected)
+    {
+        const size_t binCount = static_cast<size_t>(mapping.lastBin) + 1;
+        for(size_t i = 0; i < pixels * channels; i += channels){
+            size_t* channelCounts = counts;
+            for(int c = 0; c < channels; c++, channelCounts += binCount){
+                const double value = data[i + c];
+                if(mapping.contains(value))
+                    channelCounts[mapping.index(value)]++;
+                else
+                    rejectValue(value, rejected);
+            }
+        }
+    }
+
+    //Number of interleaved sub-tables. Consecutive values are counted into different sub-tables, so that runs of the same value
+    //don't stall on the store of the previous increment
+    constexpr size_t NUMBER_OF_SUBTABLES = 4;
+
+    //32-bit sub-table counters are moved into the wide counters before they can overflow
+    constexpr size_t VALUES_PER_FLUSH = size_t{1} << 30;
+
+    template<typename T>
+    void countValuesOfStripe(const cv::Mat& input, const int stripe, const int stripeCount, size_t* valueCounts)
+    {
+        static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "Direct counting is only meant for 8-bit and 16-bit unsigned values");
+        constexpr size_t TABLE_SIZE = size_t{1} << (8 * sizeof(T));
+
+        std::vector<uint32_t> subTables(TABLE_SIZE * NUMBER_OF_SUBTABLES, 0);
+        size_t pendingValues = 0;
+
+        const auto lambda_flush = [&](){
+            for(size_t value = 0; value < TABLE_SIZE; value++){
+                uint32_t* counters = &subTables[value * NUMBER_OF_SUBTABLES];
+                for(size_t k = 0; k < NUMBER_OF_SUBTABLES; k++){
+                    valueCounts[value] += counters[k];
+                    counters[k] = 0;
+                }
+            }
+            pendingValues = 0;
+        };
+
+        const int channels = input.channels();
+        const auto lambda_processSpan = [&](const T* data, const size_t pixels, const size_t){
+            for(size_t begin = 0; begin < pixels; begin += VALUES_PER_FLUSH){
+                const size_t end = std::min(pixels, begin + VALUES_PER_FLUSH);
+                if(pendingValues + (end - begin) > VALUES_PER_FLUSH)
+                    lambda_flush();
+
+                size_t i = begin;
+                for(; i + NUMBER_OF_SUBTABLES <= end; i += NUMBER_OF_SUBTABLES){
+                    subTables[(data[i * channels] * NUMBER_OF_SUBTABLES)]++;
+                    subTables[(data[(i + 1) * channels] * NUMBER_OF_SUBTABLES) + 1]++;
+                    subTables[(data[(i + 2) * channels] * NUMBER_OF_SUBTABLES) + 2]++;
+                    subTables[(data[(i + 3) * channels] * NUMBER_OF_SUBTABLES) + 3]++;
+                }
+                for(; i < end; i++){
+                    subTables[data[i * channels] * NUMBER_OF_SUBTABLES]++;
+                }
+                pendingValues += end - begin;
+            }
+        };
+        forEachSpan<T>(input, stripe, stripeCount, lambda_processSpan);
+        lambda_flush();
+    }
+
+    void checkInput(const cv::Mat& input)
+    {
+        if(input.empty())
+            throw std::invalid_argument("Array to be binned cannot be empty");
+        if(!input.isContinuous() && input.dims > 2)
+            throw std::invalid_argument("Non-continuous arrays should have two dimensions at most");
+    }
+
+    int usableStripeCount(const cv::Mat& input, const int parallelism)
+    {
+        //Non-continuous arrays cannot have more stripes than rows
+        const int stripes = HistogramBinning::stripeCount(input.total(), parallelism);
+        return (input.isContinuous())? stripes : std::min(stripes, input.rows);
+    }
+
+    //The mask and the weights should match the input pixel by pixel, the regions should lie within the input
+    void checkSelection(const cv::Mat& input, const HistogramBinning::PixelSelection& selection)
+    {
+        checkInput(input);
+        if(input.dims > 2)
+            throw std::invalid_argument("Pixels can only be selected from arrays with two dimensions");
+        if(!selection.mask.empty() && (selection.mask.type() != CV_8UC1 || selection.mask.size() != input.size()))
+            throw std::invalid_argument("Mask should be a CV_8UC1 array of the size of the input");
+        if(!selection.weights.empty() && (selection.weights.type() != CV_32FC1 || selection.weights.size() != input.size()))
+            throw std::invalid_argument("Weights should be a CV_32FC1 array of the size of the input");
+
+        const cv::Rect bounds(0, 0, input.cols, input.rows);
+        for(const cv::Rect& region : selection.regions){
+            if((region & bounds) != region)
+                throw std::invalid_argument("Regions should lie within the input");
+        }
+    }
+
+    //Calls the functor with the input, the mask and the weights of every region of the selection. Regions are views of the arrays, nothing is copied
+    template<typename Functor>
+    void forEachRegion(const cv::Mat& input, const HistogramBinning::PixelSelection& selection, Functor&& functor)
+    {
+        if(selection.regions.empty()){
+            functor(input, selection.mask, selection.weights);
+            return;
+        }
+
+        for(const cv::Rect& region : selection.regions){
+            if(region.empty())
+                continue;
+
+            const cv::Mat regionMask = (selection.mask.empty())? cv::Mat() : selection.mask(region);
+            const cv::Mat regionWeights = (selection.weights.empty())? cv::Mat() : selection.weights(region);
+            functor(input(region), regionMask, regionWeights);
+        }
+    }
+
+    //Finds the extremes of every stripe of the array and extends "extremes" by them. The functor extends the extremes of its stripe by a span of pixels
+    template<typename SpanFunctor>
+    void extendStripeMinMax(const cv::Mat& input, const int parallelism, std::pair<double, double>& extremes, SpanFunctor&& lambda_spanMinMax)
+    {
+        //Each stripe keeps its own extremes, merging them afterwards doesn't depend on the scheduling
+        const int stripes = usableStripeCount(input, parallelism);
+        std::vector<std::pair<double, double>> stripeExtremes(stripes, {std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()});
+
+        const auto lambda_processStripes = [&](const cv::Range& range){
+            for(int stripe = range.start; stripe < range.end; stripe++){
+                auto&[minValue, maxValue] = stripeExtremes[stripe];
+                visitDepth(input.depth(), [&](auto depthTag){
+                    using T = decltype(depthTag);
+                    const auto lambda_processSpan = [&](const T* data, const size_t pixels, const size_t firstPixel){ lambda_spanMinMax(data, pixels, firstPixel, minValue, maxValue); };
+                    forEachSpan<T>(input, stripe, stripes, lambda_processSpan);
+                });
+            }
+        };
+
+        if(stripes == 1)
+            lambda_processStripes(cv::Range(0, 1));
+        else
+            cv::parallel_for_(cv::Range(0, stripes), lambda_processStripes, stripes);
+
+        for(const auto&[stripeMin, stripeMax] : stripeExtremes){
+            extremes.first = std::min(extremes.first, stripeMin);
+            extremes.second = std::max(extremes.second, stripeMax);
+        }
+    }
+
+    //Counts every stripe of the array into private counters and adds them to "counts". The functor counts a span of pixels into the
+    //counters of its stripe, rejected values of every stripe are tallied separately as well
+    template<typename Count, typename SpanFunctor>
+    void countStripes(const cv::Mat& input, const int parallelism, std::vector<Count>& counts, HistogramBinning::RejectedValues* rejected, SpanFunctor&& lambda_countSpan)
+    {
+        const int stripes = usableStripeCount(input, parallelism);
+        const auto lambda_countStripe = [&](const int stripe, Count* stripeCounts, HistogramBinning::RejectedValues& stripeRejected){
+            visitDepth(input.depth(), [&](auto depthTag){
+                using T = decltype(depthTag);
+                const auto lambda_processSpan = [&](const T* data, const size_t pixels, const size_t firstPixel){ lambda_countSpan(data, pixels, firstPixel, stripeCounts, stripeRejected); };
+                forEachSpan<T>(input, stripe, stripes, lambda_processSpan);
+            });
+        };
+
+        std::vector<HistogramBinning::RejectedValues> stripeRejected(stripes);
+        if(stripes == 1){
+            lambda_countStripe(0, counts.data(), stripeRejected.front());
+        }
+        else{
+            //Every stripe fills its private bins, so the threads never write to the same counter
+            std::vector<std::vector<Count>> stripeCounts(stripes, std::vector<Count>(counts.size(), 0));
+            cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range){
+                for(int stripe = range.start; stripe < range.end; stripe++){
+                    lambda_countStripe(stripe, stripeCounts[stripe].data(), stripeRejected[stripe]);
+                }
+            }, stripes);
+
+            for(const std::vector<Count>& partialCounts : stripeCounts){
+                std::transform(counts.begin(), counts.end(), partialCounts.begin(), counts.begin(), std::plus<Count>());
+            }
+        }
+
+        if(rejected){
+            for(const HistogramBinning::RejectedValues& partialRejected : stripeRejected){
+                rejected->outOfRange += partialRejected.outOfRange;
+                rejected->nan += partialRejected.nan;
+            }
+        }
+    }
+}
+
+void HistogramBinning::extendMinMax(const cv::Mat &input, std::pair<double, double> &extremes, const int parallelism)
+{
+    checkInput(input);
+    extendStripeMinMax(input, parallelism, extremes, [&](const auto* data, const size_t pixels, const size_t, double& minValue, double& maxValue){
+        spanMinMax(data, pixels * input.channels(), minValue, maxValue);
+    });
+}
+
+std::pair<double, double> HistogramBinning::minMax(const cv::Mat &input, const PixelSelection &selection, const int parallelism)
+{
+    checkSelection(input, selection);
+
+    //Only the selected runs are searched, weights don't matter
+    std::pair<double, double> extremes{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    forEachRegion(input, selection, [&](const cv::Mat& regionInput, const cv::Mat& regionMask, const cv::Mat&){
+        extendStripeMinMax(regionInput, parallelism, extremes, [&](const auto* data, const size_t pixels, const size_t firstPixel, double& minValue, double& maxValue){
+            forEachSelectedRun(data, pixels, firstPixel, input.channels(), regionInput.cols, regionMask, cv::Mat(), [&](const auto* runData, const size_t runPixels, const float*){
+                spanMinMax(runData, runPixels * input.channels(), minValue, maxValue);
+            });
+        });
+    });
+
+    if(extremes.first > extremes.second)
+        return {0.0, 0.0};
+
+    return extremes;
+}
+
+std::pair<double, double> HistogramBinning::minMax(const cv::Mat &input, const int parallelism)
+{
+    std::pair<double, double> extremes{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    extendMinMax(input, extremes, parallelism);
+
+    //Like cv::minMaxLoc, zero is reported if the array has no comparable values at all
+    if(extremes.first > extremes.second)
+        return {0.0, 0.0};
+
+    return extremes;
+}
+
+std::vector<size_t> HistogramBinning::countBins(const cv::Mat &input, const size_t binCount, const float binStart, const float binEnd, const int parallelism, RejectedValues* rejected)
+{
+    std::vector<size_t> counts(binCount, 0);
+    accumulateCounts(input, binStart, binEnd, counts, parallelism, rejected);
+    return counts;
+}
+
+void HistogramBinning::accumulateCounts(const cv::Mat &input, const float binStart, const float binEnd, std::vector<size_t> &counts, const int parallelism, RejectedValues* rejected)
+{
+    checkInput(input);
+    if(counts.empty())
+        throw std::invalid_argument("number of bins cannot be zero");
+
+    const BinMapping mapping(binStart, binEnd, counts.size());
+    countStripes(input, parallelism, counts, rejected, [&](const auto* data, const size_t pixels, const size_t, size_t* stripeCounts, RejectedValues& stripeRejected){
+        spanCounts(data, pixels, input.channels(), mapping, UnitCounter{stripeCounts}, stripeRejected);
+    });
+}
+
+std::vector<size_t> HistogramBinning::countBins(const cv::Mat &input, const PixelSelection &selection, const size_t binCount, const float binStart, const float binEnd,
+                                                const int parallelism, RejectedValues *rejected)
+{
+    checkSelection(input, selection);
+    if(binCount == 0)
+        throw std::invalid_argument("number of bins cannot be zero");
+    if(!selection.weights.empty())
+        throw std::invalid_argument("Weighted pixels should be counted by countWeightedBins");
+
+    //Every selected run is a contiguous span, so it is counted like the spans of an unrestricted array
+    const BinMapping mapping(binStart, binEnd, binCount);
+    std::vector<size_t> counts(binCount, 0);
+    forEachRegion(input, selection, [&](const cv::Mat& regionInput, const cv::Mat& regionMask, const cv::Mat&){
+        countStripes(regionInput, parallelism, counts, rejected, [&](const auto* data, const size_t pixels, const size_t firstPixel, size_t* stripeCounts, RejectedValues& stripeRejected){
+            forEachSelectedRun(data, pixels, firstPixel, input.channels(), regionInput.cols, regionMask, cv::Mat(), [&](const auto* runData, const size_t runPixels, const float*){
+                spanCounts(runData, runPixels, input.channels(), mapping, UnitCounter{stripeCounts}, stripeRejected);
+            });
+        });
+    });
+    return counts;
+}
+
+std::vector<double> HistogramBinning::countWeightedBins(const cv::Mat &input, const PixelSelection &selection, const size_t binCount, const float binStart, const float binEnd,
+                                                        const int parallelism, RejectedValues *rejected)
+{
+    checkSelection(input, selection);
+    if(binCount == 0)
+        throw std::invalid_argument("number of bins cannot be zero");
+    if(selection.weights.empty())
+        throw std::invalid_argument("Weights of the pixels are missing");
+
+    const BinMapping mapping(binStart, binEnd, binCount);
+    std::vector<double> counts(binCount, 0.0);
+    forEachRegion(input, selection, [&](const cv::Mat& regionInput, const cv::Mat& regionMask, const cv::Mat& regionWeights){
+        countStripes(regionInput, parallelism, counts, rejected, [&](const auto* data, const size_t pixels, const size_t firstPixel, double* stripeCounts, RejectedValues& stripeRejected){
+            forEachSelectedRun(data, pixels, firstPixel, input.channels(), regionInput.cols, regionMask, regionWeights, [&](const auto* runData, const size_t runPixels, const float* runWeights){
+                spanCounts(runData, runPixels, input.channels(), mapping, WeightedCounter{stripeCounts, runWeights}, stripeRejected);
+            });
+        });
+    });
+    return counts;
+}
+
+std::vector<std::vector<size_t>> HistogramBinning::countChannels(const cv::Mat &input, const size_t binCount, const float binStart, const float binEnd, const int parallelism, RejectedValues *rejected)
+{
+    checkInput(input);
+    if(binCount == 0)
+        throw std::invalid_argument("number of bins cannot be zero");
+
+    //The bins of every channel are kept consecutively in a single table, so that a stripe merges all of its channels at once
+    const BinMapping mapping(binStart, binEnd, binCount);
+    std::vector<size_t> channelCounts(binCount * input.channels(), 0);
+    countStripes(input, parallelism, channelCounts, rejected, [&](const auto* data, const size_t pixels, const size_t, size_t* stripeCounts, RejectedValues& stripeRejected){
+        spanChannelCounts(data, pixels, input.channels(), mapping, stripeCounts, stripeRejected);
+    });
+
+    std::vector<std::vector<size_t>> counts;
+    for(auto it_channel = channelCounts.cbegin(); it_channel != channelCounts.cend(); it_channel += binCount){
+        counts.emplace_back(it_channel, it_channel + binCount);
+    }
+    return counts;
+}
+
+bool HistogramBinning::supportsValueCounts(const cv::Mat &input)
+{
+    return input.depth() == CV_8U || input.depth() == CV_16U;
+}
+
+std::vector<size_t> HistogramBinning::valueCounts(const cv::Mat &input, const int parallelism)
+{
+    checkInput(input);
+    if(!supportsValueCounts(input))
+        throw std::invalid_argument("Only 8-bit and 16-bit unsigned arrays can be counted by their values");
+
+    const size_t tableSize = (input.depth() == CV_8U)? (size_t{1} << 8) : (size_t{1} << 16);
+    const auto lambda_countStripe = [&](const int stripe, const int stripes, size_t* stripeCounts){
+        if(input.depth() == CV_8U)
+            countValuesOfStripe<uint8_t>(input, stripe, stripes, stripeCounts);
+        else
+            countValuesOfStripe<uint16_t>(input, stripe, stripes, stripeCounts);
+    };
+
+    std::vector<size_t> counts(tableSize, 0);
+    const int stripes = usableStripeCount(input, parallelism);
+    if(stripes == 1){
+        lambda_countStripe(0, 1, counts.data());
+        return counts;
+    }
+
+    //Every stripe fills its private table, so the threads never write to the same counter
+    std::vector<std::vector<size_t>> stripeCounts(stripes, std::vector<size_t>(tableSize, 0));
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range){
+        for(int stripe = range.start; stripe < range.end; stripe++){
+            lambda_countStripe(stripe, stripes, stripeCounts[stripe].data());
+        }
+    }, stripes);
+
+    for(const std::vector<size_t>& partialCounts : stripeCounts){
+        std::transform(counts.begin(), counts.end(), partialCounts.begin(), counts.begin(), std::plus<size_t>());
+    }
+    return counts;
+}
+
+std::pair<double, double> HistogramBinning::minMax(const std::vector<size_t> &valueCounts)
+{
+    const auto lambda_isCounted = [](const size_t count){ return count != 0; };
+    const auto first = std::find_if(valueCounts.begin(), valueCounts.end(), lambda_isCounted);
+    if(first == valueCounts.end())
+        return {0.0, 0.0};
+
+    const auto last = std::find_if(valueCounts.rbegin(), valueCounts.rend(), lambda_isCounted);
+    return {static_cast<double>(first - valueCounts.begin()), static_cast<double>(valueCounts.rend() - last - 1)};
+}
+
+std::vector<size_t> HistogramBinning::foldValueCounts(const std::vector<size_t> &valueCounts, const size_t binCount, const float binStart, const float binEnd, RejectedValues* rejected)
+{
+    if(binCount == 0)
+        throw std::invalid_argument("number of bins cannot be zero");
+
+    //Every value is mapped with the same arithmetic as the values of the array, so the result is identical to countBins
+    const BinMapping mapping(binStart, binEnd, binCount);
+    std::vector<size_t> counts(binCount, 0);
+    for(size_t value = 0; value < valueCounts.size(); value++){
+        if(!valueCounts[value])
+            continue;
+
+        if(mapping.contains(static_cast<double>(value)))
+            counts[mapping.index(static_cast<double>(value))] += valueCounts[value];
+        else if(rejected)
+            rejected->outOfRange += valueCounts[value];
+    }
+    return counts;
+}
+
+cv::Mat HistogramBinning::sample(const cv::Mat &input, const Sampling &sampling)
+{
+    checkInput(input);
+    if(sampling.sampleCount == 0)
+        throw std::invalid_argument("number of samples cannot be zero");
+
+    const size_t totalPixels = input.total();
+    if(sampling.sampleCount >= totalPixels)
+        return input;
+
+    //Non-continuous arrays have two dimensions, so a linear pixel index can be split into a row and a column
+    const size_t pixelSize = input.elemSize();
+    const auto lambda_pixel = [&](const size_t index) -> const uchar* {
+        if(input.isContinuous())
+            return input.data + (index * pixelSize);
+        return input.ptr(static_cast<int>(index / input.cols)) + ((index % input.cols) * pixelSize);
+    };
+
+    cv::RNG rng(sampling.seed);
+    const auto lambda_randomIndex = [&](const size_t count) -> size_t {
+        const uint64_t random = (static_cast<uint64_t>(rng.next()) << 32) | rng.next();
+        return static_cast<size_t>(random % count);
+    };
+
+    cv::Mat samples(1, static_cast<int>(sampling.sampleCount), input.type());
+    uchar* out = samples.data;
+    switch (sampling.method) {
+    case SamplingMethod::Strided:
+        for(size_t i = 0; i < sampling.sampleCount; i++){
+            std::memcpy(out + (i * pixelSize), lambda_pixel(i * totalPixels / sampling.sampleCount), pixelSize);
+        }
+        break;
+    case SamplingMethod::Random:
+        for(size_t i = 0; i < sampling.sampleCount; i++){
+            std::memcpy(out + (i * pixelSize), lambda_pixel(lambda_randomIndex(totalPixels)), pixelSize);
+        }
+        break;
+    case SamplingMethod::Block: {
+        //Blocks of continuous arrays may cross the rows, others are kept within a row
+        const size_t runLength = (input.isContinuous())? totalPixels : static_cast<size_t>(input.cols);
+        const size_t blockLength = std::min(SAMPLING_BLOCK_LENGTH, runLength);
+        for(size_t i = 0; i < sampling.sampleCount; i += blockLength){
+            const size_t length = std::min(blockLength, sampling.sampleCount - i);
+            const size_t run = lambda_randomIndex(totalPixels / runLength);
+            const size_t offset = lambda_randomIndex(runLength - length + 1);
+            std::memcpy(out + (i * pixelSize), lambda_pixel((run * runLength) + offset), length * pixelSize);
+        }
+        break;
+    }
+    }
+
+    return samples;
+}
+
+std::vector<std::pair<size_t, size_t>> HistogramBinning::confidenceIntervals(const std::vector<size_t> &sampleCounts, const size_t sampleCount, const size_t totalCount)
+{
+    if(sampleCount == 0)
+        throw std::invalid_argument("number of samples cannot be zero");
+
+    constexpr double Z_95 = 1.959963984540054;
+    const double n = static_cast<double>(sampleCount);
+    const double zSquaredPerN = Z_95 * Z_95 / n;
+
+    std::vector<std::pair<size_t, size_t>> intervals;
+    intervals.reserve(sampleCounts.size());
+    for(const size_t count : sampleCounts){
+        //Wilson score interval of the proportion of the bin, which stays within [0, 1] even for empty and full bins
+        const double proportion = count / n;
+        const double center = (proportion + (zSquaredPerN / 2)) / (1 + zSquaredPerN);
+        const double halfWidth = Z_95 * std::sqrt((proportion * (1 - proportion) / n) + (zSquaredPerN / (4 * n))) / (1 + zSquaredPerN);
+
+        const double lower = std::max(0.0, center - halfWidth) * totalCount;
+        const double upper = std::min(1.0, center + halfWidth) * totalCount;
+        intervals.emplace_back(static_cast<size_t>(std::floor(lower)), static_cast<size_t>(std::ceil(upper)));
+    }
+    return intervals;
+}
+
+HistogramBinning::BinRange HistogramBinning::resolveBinRange(const std::pair<double, double> &extremes, const std::optional<int> binCount, const std::optional<float> binStart, const std::optional<float> binEnd)
+{
+    if(binCount && *binCount == 0)
+        throw std::invalid_argument("number of bins cannot be zero");
+
+    //Extends the min-max values for padding
+    constexpr float HISTOGRAM_AXES_PADDING_PERCENTAGE = 0.05F;
+    const auto lambda_addLeftPadding = [=](float value) -> float {return (value > 0)? value * (1 - HISTOGRAM_AXES_PADDING_PERCENTAGE) : value * (1 + HISTOGRAM_AXES_PADDING_PERCENTAGE); };
+    const auto lambda_addRightPadding = [=](float value) -> float {return (value > 0)? value * (1 + HISTOGRAM_AXES_PADDING_PERCENTAGE) : value * (1 - HISTOGRAM_AXES_PADDING_PERCENTAGE); };
+
+    BinRange range;
+    range.binStart = binStart.value_or(lambda_addLeftPadding(extremes.first));
+    range.binEnd = binEnd.value_or(lambda_addRightPadding(extremes.second));
+
+    const int count = binCount.value_or(range.binEnd - range.binStart + 1);
+    if(count <= 0)
+        throw std::invalid_argument("number of bins should be positive");
+
+    range.binCount = static_cast<size_t>(count);
+    return range;
+}
+
+int HistogramBinning::stripeCount(const size_t totalValues, const int parallelism)
+{
+    if(parallelism < 0)
+        throw std::invalid_argument("Maximum number of threads cannot be negative");
+
+    const size_t threads = (parallelism > 0)? static_cast<size_t>(parallelism) : static_cast<size_t>(std::max(cv::getNumThreads(), 1));
+    return static_cast<int>(std::clamp<size_t>(totalValues / MINIMUM_VALUES_PER_STRIPE, 1, threads));
+}
@@ -0,0 +1,204 @@
+#include "histogramstorage.h"
+#include "PlotUtils.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace {
+    constexpr size_t MAXIMUM_NARROW_COUNT = std::numeric_limits<uint32_t>::max();
+
+    void checkLength(const size_t stored, const size_t given)
+    {
+        if(stored != given)
+            throw std::invalid_argument("Length mismatch between the stored and the given counts");
+    }
+
+    //Wide storage can only be handed out as size_t counts where size_t is the 64-bit count
+    template<typename Storage>
+    std::vector<size_t>* asSizeCounts(Storage* counts)
+    {
+        if constexpr (std::is_same_v<Storage, std::vector<size_t>>)
+            return counts;
+        else
+            return nullptr;
+    }
+}
+
+HistogramCounts::HistogramCounts(const std::vector<size_t> &counts, const CountWidth width) :
+    m_counts(std::vector<uint64_t>(counts.begin(), counts.end()))
+{
+    setWidth(width);
+}
+
+HistogramCounts::HistogramCounts(std::vector<size_t> &&counts, const CountWidth width)
+{
+    //The vector can be adopted without a copy where size_t is the 64-bit count
+    if constexpr (std::is_same_v<size_t, uint64_t>)
+        m_counts = std::move(counts);
+    else
+        m_counts = std::vector<uint64_t>(counts.begin(), counts.end());
+
+    setWidth(width);
+}
+
+size_t HistogramCounts::size() const
+{
+    return std::visit([](const auto& counts){ return counts.size(); }, m_counts);
+}
+
+size_t HistogramCounts::operator[](const size_t index) const
+{
+    if(const auto* narrowCounts = std::get_if<std::vector<uint32_t>>(&m_counts))
+        return (*narrowCounts)[index];
+
+    return static_cast<size_t>(std::get<std::vector<uint64_t>>(m_counts)[index]);
+}
+
+size_t HistogramCounts::max() const
+{
+    return std::visit([](const auto& counts) -> size_t { return (counts.empty())? 0 : static_cast<size_t>(*std::max_element(counts.begin(), counts.end())); }, m_counts);
+}
+
+std::vector<size_t>* HistogramCounts::wideCounts()
+{
+    return asSizeCounts(std::get_if<std::vector<uint64_t>>(&m_counts));
+}
+
+void HistogramCounts::setWidth(const CountWidth width)
+{
+    if(width == this->width())
+        return;
+
+    if(width == CountWidth::Bits64){
+        widen();
+        return;
+    }
+
+    //Narrow storage would lose the counts that don't fit into it
+    if(max() > MAXIMUM_NARROW_COUNT)
+        return;
+
+    const std::vector<uint64_t>& wideCounts = std::get<std::vector<uint64_t>>(m_counts);
+    m_counts = std::vector<uint32_t>(wideCounts.begin(), wideCounts.end());
+}
+
+void HistogramCounts::set(const size_t index, const size_t count)
+{
+    if(count > MAXIMUM_NARROW_COUNT)
+        widen();
+
+    std::visit([=](auto& counts){ counts[index] = static_cast<typename std::decay_t<decltype(counts)>::value_type>(count); }, m_counts);
+}
+
+void HistogramCounts::fill(const size_t count)
+{
+    if(count > MAXIMUM_NARROW_COUNT)
+        widen();
+
+    std::visit([=](auto& counts){ std::fill(counts.begin(), counts.end(), static_cast<typename std::decay_t<decltype(counts)>::value_type>(count)); }, m_counts);
+}
+
+void HistogramCounts::add(const std::vector<size_t> &counts)
+{
+    checkLength(size(), counts.size());
+
+    //Sums that don't fit into the narrow storage widen it beforehand
+    if(const auto* narrowCounts = std::get_if<std::vector<uint32_t>>(&m_counts)){
+        const bool isOverflowing = !std::equal(narrowCounts->begin(), narrowCounts->end(), counts.begin(), [](const uint32_t stored, const size_t added){ return added <= MAXIMUM_NARROW_COUNT - stored; });
+        if(isOverflowing)
+            widen();
+    }
+
+    std::visit([&](auto& storedCounts){
+        using T = typename std::decay_t<decltype(storedCounts)>::value_type;
+        std::transform(storedCounts.begin(), storedCounts.end(), counts.begin(), storedCounts.begin(), [](const T stored, const size_t added){ return static_cast<T>(stored + added); });
+    }, m_counts);
+}
+
+void HistogramCounts::subtract(const std::vector<size_t> &counts)
+{
+    checkLength(size(), counts.size());
+
+    std::visit([&](auto& storedCounts){
+        using T = typename std::decay_t<decltype(storedCounts)>::value_type;
+        std::transform(storedCounts.begin(), storedCounts.end(), counts.begin(), storedCounts.begin(), [](const T stored, const size_t subtracted){ return static_cast<T>(stored - subtracted); });
+    }, m_counts);
+}
+
+std::vector<size_t> HistogramCounts::toVector() const
+{
+    return std::visit([](const auto& counts){ return std::vector<size_t>(counts.begin(), counts.end()); }, m_counts);
+}
+
+void HistogramCounts::widen()
+{
+    if(const auto* narrowCounts = std::get_if<std::vector<uint32_t>>(&m_counts))
+        m_counts = std::vector<uint64_t>(narrowCounts->begin(), narrowCounts->end());
+}
+
+bool operator==(const HistogramCounts &lhs, const HistogramCounts &rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+bool operator==(const HistogramCounts &lhs, const std::vector<size_t> &rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+bool operator==(const std::vector<size_t> &lhs, const HistogramCounts &rhs)
+{
+    return rhs == lhs;
+}
+
+BinsView::BinsView(const float start, const float end, const size_t count) :
+    m_start(start),
+    m_end(end),
+    m_count(count),
+    m_step((static_cast<double>(end) - start) / std::max<size_t>(count - 1, 1))
+{
+    if(count == 0)
+        throw std::invalid_argument("Number of the bins cannot be zero");
+}
+
+BinsView::BinsView(std::vector<float> &&bins) :
+    m_values(std::make_shared<const std::vector<float>>(std::move(bins)))
+{}
+
+float BinsView::operator[](const size_t index) const
+{
+    if(m_values)
+        return (*m_values)[index];
+
+    //The last bin is exactly the end of the range
+    if(index + 1 == m_count)
+        return m_end;
+
+    return static_cast<float>(m_start + (index * m_step));
+}
+
+std::vector<float> BinsView::toVector() const
+{
+    if(m_values)
+        return *m_values;
+
+    //Uniform bins are accumulated like PlotUtils::linspace does, so the values are identical to the explicitly computed bins
+    return PlotUtils::linspace(m_start, m_end, m_count);
+}
+
+bool operator==(const BinsView &lhs, const BinsView &rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+bool operator==(const BinsView &lhs, const std::vector<float> &rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+bool operator==(const std::vector<float> &lhs, const BinsView &rhs)
+{
+    return rhs == lhs;
+}
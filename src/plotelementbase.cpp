@@ -1,31 +1,34 @@
 #include "plotelementbase.h"
 #include "PlotUtils.h"
-#include <iomanip>
-#include <sstream>
+#include "glyphatlas.h"
+#include "textmetrics.h"
+#include <atomic>
+#include <cstring>
+#include "textrastercache.h"
 
 using namespace PainterConstants;
 
-//allocateTextSpace constant expressions
-constexpr uint32_t TEXT_CANVAS_HEIGHT_NORM = 40;
-constexpr uint32_t SPACE_CHAR_WIDTH_START = 30;
-constexpr uint32_t LETTER_WIDTH_START = 20;
+//Text canvas layout constant expressions
+constexpr float_t TEXT_CANVAS_HEIGHT_NORM = 40;
+constexpr float_t TEXT_MARGIN_NORM = 10;
+constexpr int TEXT_THICKNESS = 1;
 
 //addAxis constant expressions
 constexpr size_t MINIMUM_PIXELS_BETWEEN_AXES = 70;
 constexpr size_t NUMBER_OF_AXES = 6;
 constexpr int OFFSET_TEXT_LINE = 10;
 
-static cv::Size allocateTextSpace(const float_t fontSize, const std::string_view text)
+static int textMargin(const float_t fontSize)
 {
-    const int paddingSize = static_cast<int>(10 * fontSize);
-    const auto countSpaces = std::count(text.begin(), text.end(), ' ');
-    const uint32_t countLetters = text.length() - countSpaces;
-
-    //These pixel sizes will give a rough estimation for the text canvas shape. The final canvas length will be decided from the resulting canvas
-    const uint32_t canvasLength = (SPACE_CHAR_WIDTH_START * countSpaces) + (LETTER_WIDTH_START * countLetters) * fontSize + (2* paddingSize);
-    const uint32_t canvasHeight = TEXT_CANVAS_HEIGHT_NORM * fontSize;
+    return static_cast<int>(TEXT_MARGIN_NORM * fontSize);
+}
 
-    return cv::Size(canvasLength, canvasHeight);
+static cv::Mat rasterizeText(const float_t fontSize, const std::string_view text, const cv::Scalar& textColor, const cv::Size& canvasSize)
+{
+    const int marginSize = textMargin(fontSize);
+    cv::Mat canvas = cv::Mat(canvasSize, CV_8UC3, white);
+    cv::putText(canvas, cv::String{text.data(), text.size()}, cv::Point{marginSize, canvasSize.height - marginSize}, font, fontSize, textColor, TEXT_THICKNESS, cv::LINE_AA);
+    return canvas;
 }
 
 std::string PlotElementBase::getText(const TextField field) const
@@ -56,6 +59,7 @@ void PlotElementBase::setText(const TextField component, const std::string& text
         m_yAxisColor = color;
         m_yAxisSize = textSize * DEFAULT_YAXIS_SIZE;
     }
+    markModified();
 }
 
 void PlotElementBase::setText(const TextField component, std::string &&text, const float textSize, const cv::Scalar color)
@@ -78,6 +82,7 @@ void PlotElementBase::setText(const TextField component, std::string &&text, con
         break;
     default: break;
     }
+    markModified();
 }
 
 void PlotElementBase::setPrecision(const AxisType axisType, const uint8_t precision)
@@ -86,6 +91,19 @@ void PlotElementBase::setPrecision(const AxisType axisType, const uint8_t precis
     case AxisType::XAxis: m_precision_x = precision; break;
     case AxisType::YAxis: m_precision_y = precision; break;
     }
+    markModified();
+}
+
+uint64_t PlotElementBase::nextRevision()
+{
+    //Zero is never assigned, so that it can represent a canvas that hasn't been rendered yet
+    static std::atomic<uint64_t> revisionCounter{0};
+    return ++revisionCounter;
+}
+
+bool PlotElementBase::isCanvasUpToDate(const uint64_t currentRevision) const
+{
+    return !m_canvas.empty() && (m_renderedRevision == currentRevision) && (m_renderedSize == canvasSize);
 }
 
 void PlotElementBase::centerElement(cv::Mat &target, const cv::Size &centerArea, const AlignmentType alignmentType)
@@ -138,6 +156,50 @@ cv::Mat PlotElementBase::centerElement(const cv::Mat &target, const cv::Size &ce
     return centered;
 }
 
+void PlotElementBase::placeElement(const cv::Mat &element, cv::Mat &target, const cv::Rect &area, const AlignmentType alignmentType)
+{
+    //Check for the illegal conditions
+    if(element.empty())
+        throw std::runtime_error("Element matrix cannot be empty");
+
+    //Calculate the paddings for centering the element within the area
+    const int paddingRows = (alignmentType == AlignmentType::HeightOnly || alignmentType == AlignmentType::WholeShape)? (area.height - element.rows) / 2 : 0;
+    const int paddingCols = (alignmentType == AlignmentType::WidthOnly || alignmentType == AlignmentType::WholeShape)? (area.width - element.cols) / 2 : 0;
+
+    if(paddingRows < 0 || paddingCols < 0)
+        throw std::runtime_error("Area to be aligned has dimensions smaller than the element");
+
+    element.copyTo(target(cv::Rect(area.x + paddingCols, area.y + paddingRows, element.cols, element.rows)));
+}
+
+void PlotElementBase::fillArea(cv::Mat &area, const cv::Scalar &color)
+{
+    if(area.type() != CV_8UC3)
+        throw std::runtime_error("Filling operation is only meant to be used on 8UC3 type cv::Mat arrays (aka. plot related elements)");
+
+    //Gray levels (including white and black) can be written row by row without any per-pixel work
+    const cv::Vec3b pixel(cv::saturate_cast<uchar>(color[0]), cv::saturate_cast<uchar>(color[1]), cv::saturate_cast<uchar>(color[2]));
+    const bool isGrayLevel = (pixel[0] == pixel[1]) && (pixel[1] == pixel[2]);
+    const size_t rowLength = static_cast<size_t>(area.cols) * area.elemSize();
+
+    for(int r = 0; r < area.rows; r++){
+        if(isGrayLevel){
+            std::memset(area.ptr(r), pixel[0], rowLength);
+        }
+        else{
+            cv::Vec3b* row = area.ptr<cv::Vec3b>(r);
+            std::fill(row, row + area.cols, pixel);
+        }
+    }
+}
+
+void PlotElementBase::prepareCanvas(cv::Mat &out) const
+{
+    //Reuses the buffer of "out" when it already has the right shape, including the submatrices of a larger canvas
+    out.create(canvasSize, CV_8UC3);
+    fillArea(out, white);
+}
+
 void PlotElementBase::addAxis(cv::Mat &plotElement, const OffsetRange offset_x, const OffsetRange offset_y, const AxisRange range_x, const AxisRange range_y) const
 {
     //Constants that will repeteadly be used
@@ -146,12 +208,11 @@ void PlotElementBase::addAxis(cv::Mat &plotElement, const OffsetRange offset_x,
 
     //Start with determining the numbers to be placed on the element
     const int numberofAxes_x = std::min((plotElement.cols - offset_x.first - offset_x.second - yAxisTextWidth()) / MINIMUM_PIXELS_BETWEEN_AXES, NUMBER_OF_AXES);
-    const std::vector<double> xAxisNumbers(PlotUtils::linspace(range_x.first, range_x.second, numberofAxes_x));
 
     //Place each number for the x-axis
     const int xAxisStart = offset_x.first + yAxisTextWidth();
     int xAxisPosCounter = xAxisStart;
-    for(const double currentNumber: xAxisNumbers){
+    PlotUtils::linspace_for_each(range_x.first, range_x.second, numberofAxes_x, [&](const double currentNumber){
         cv::line(plotElement, {xAxisPosCounter, BOTTOM_XAXIS}, {xAxisPosCounter, LINE_END_XAXIS}, cv::LINE_AA);
 
         //Center the x-Axis text (except when it can't)
@@ -163,15 +224,14 @@ void PlotElementBase::addAxis(cv::Mat &plotElement, const OffsetRange offset_x,
 
         //Update the x-axis position counter
         xAxisPosCounter += (plotElement.cols - offset_x.first - offset_x.second - yAxisTextWidth()) / (numberofAxes_x - 1);
-    }
+    });
 
     //Apply similar precedure for y-axis. y-axis numbers should be reverse ordered
     const int numberofAxes_y = std::min((plotElement.rows - offset_y.first - offset_y.second - xAxisTextHeight()) / MINIMUM_PIXELS_BETWEEN_AXES, NUMBER_OF_AXES);
-    const std::vector<double> yAxisNumbers(PlotUtils::linspace(range_y.second, range_y.first, numberofAxes_y));
 
     //Place each number for the y-axis.
     int yAxisPosCounter = offset_y.first;
-    for(const double currentNumber: yAxisNumbers){
+    PlotUtils::linspace_for_each(range_y.second, range_y.first, numberofAxes_y, [&](const double currentNumber){
         cv::line(plotElement, {m_yAxisTextSize.width - 1, yAxisPosCounter}, {m_yAxisTextSize.width - LENGTH_AXIS_LINE - 1, yAxisPosCounter}, cv::LINE_AA);
 
         //Center the y-axis text (except when it can't)
@@ -184,7 +244,7 @@ void PlotElementBase::addAxis(cv::Mat &plotElement, const OffsetRange offset_x,
 
         //Update the position counter
         yAxisPosCounter += (plotElement.rows - offset_y.first - offset_y.second - xAxisTextHeight()) / (numberofAxes_y - 1);
-    }
+    });
 }
 
 cv::Mat PlotElementBase::generateText(const float_t fontSize, const std::string_view text, const cv::Scalar textColor)
@@ -193,37 +253,35 @@ cv::Mat PlotElementBase::generateText(const float_t fontSize, const std::string_
     if(textColor == white)
         throw(std::runtime_error("White cannot be chosen as the text color"));
 
-    //Estimate the space needed for the text with confident vertical margin. This margin will be trimmed soon
-    const cv::Size allocatedSpace = allocateTextSpace(fontSize, text);
-    cv::Mat canvas = cv::Mat(allocatedSpace, CV_8UC3, white);
-
-    const int marginSize = 10 * fontSize;
-    cv::putText(canvas, cv::String{text.data(), text.size()}, cv::Point{marginSize, static_cast<int>(allocatedSpace.height - marginSize)}, font, fontSize, textColor, 1, cv::LINE_AA);
+    //Same text with the same properties is rendered repeatedly, so each canvas is rendered once and then served from the cache.
+    //Numeric texts don't need the stroke renderer, they are assembled from the pre-rasterized glyphs
+    const auto lambda_rasterize = [fontSize, text, &textColor]() -> cv::Mat {
+        const cv::Size canvasSize = measureText(fontSize, text);
+        if(GlyphAtlas::canRender(text))
+            return GlyphAtlas::instance().renderText(text, fontSize, textColor, font, canvasSize, textMargin(fontSize));
 
-    uint32_t firstInstance = 0;
-    for(uint32_t curCol=canvas.cols - 1; curCol>0; curCol--){
-        cv::Mat curColumn = canvas.col(curCol);
-        if(!cv::checkRange(curColumn, true, nullptr, 255)){
-            firstInstance = curCol;
-            break;
-        }
-    }
-
-    return canvas.colRange(0,  std::min(firstInstance + marginSize, static_cast<uint32_t>(canvas.cols)));
+        return rasterizeText(fontSize, text, textColor, canvasSize);
+    };
+    return TextRasterCache::instance().getOrRender(text, fontSize, textColor, font, lambda_rasterize);
 }
 
 cv::Mat PlotElementBase::generateNumericText(const float_t fontSize, const double_t number, const uint8_t precision)
 {
-    std::stringstream stream;
-    stream << std::fixed << std::setprecision(precision) << std::scientific << number;
-    return generateText(fontSize, stream.str(), blue);
+    PlotUtils::NumberTextBuffer buffer;
+    return generateText(fontSize, PlotUtils::format_number(buffer, number, precision), blue);
 }
 
 cv::Size PlotElementBase::allocateNumericTextSpace(const float_t fontSize, const double_t number, const uint8_t precision)
 {
-    std::stringstream stream;
-    stream << std::fixed << std::setprecision(precision) << std::scientific << number;
+    PlotUtils::NumberTextBuffer buffer;
 
     //Add some toleration for the numbers that requires larger space
-    return generateText(fontSize, stream.str(), blue).size() + cv::Size{ 10, 0 };
+    return measureText(fontSize, PlotUtils::format_number(buffer, number, precision)) + cv::Size{ 10, 0 };
+}
+
+cv::Size PlotElementBase::measureText(const float_t fontSize, const std::string_view text)
+{
+    //The text is surrounded by the margin horizontally. Vertically, the margin is left below the baseline
+    const cv::Size textSize = TextMetrics::textSize(text, fontSize, font, TEXT_THICKNESS);
+    return cv::Size{textSize.width + (2 * textMargin(fontSize)), static_cast<int>(TEXT_CANVAS_HEIGHT_NORM * fontSize)};
 }
@@ -0,0 +1,223 @@
+#include "rawimagesource.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+//Chunks are memory mapped where POSIX mmap is available, they are streamed otherwise
+#if defined(__unix__) || defined(__APPLE__)
+#define RAWIMAGESOURCE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define RAWIMAGESOURCE_MMAP 0
+#endif
+
+
+namespace {
+    //Default upper limit of the bytes that are processed at once
+    constexpr size_t DEFAULT_CHUNK_SIZE = size_t{64} << 20;
+
+#if RAWIMAGESOURCE_MMAP
+    //Closes the file descriptor and unmaps the chunk also when the processing of a chunk throws
+    struct FileDescriptor
+    {
+        explicit FileDescriptor(const std::string& path) : descriptor(::open(path.c_str(), O_RDONLY)) {}
+        ~FileDescriptor() { if(descriptor >= 0) ::close(descriptor); }
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+        int descriptor;
+    };
+
+    struct MappedRegion
+    {
+        MappedRegion(const int descriptor, const size_t fileOffset, const size_t length) :
+            address(::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, static_cast<off_t>(fileOffset))),
+            length(length)
+        {}
+        ~MappedRegion() { if(address != MAP_FAILED) ::munmap(address, length); }
+        MappedRegion(const MappedRegion&) = delete;
+        MappedRegion& operator=(const MappedRegion&) = delete;
+
+        void* address;
+        size_t length;
+    };
+#endif
+}
+
+RawImageSource::RawImageSource(const std::string &path, const int type, const cv::Size &size, const size_t stride, const size_t offset, const AccessMode mode) :
+    m_path(path),
+    m_type(type),
+    m_size(size),
+    m_stride((stride == 0)? static_cast<size_t>(size.width) * CV_ELEM_SIZE(type) : stride),
+    m_offset(offset),
+    m_mode(mode),
+    m_chunkSize(DEFAULT_CHUNK_SIZE)
+{
+    if(size.width <= 0 || size.height <= 0){
+        throw(std::invalid_argument("Size of the raw image should be positive"));
+    }
+
+    const size_t rowBytes = static_cast<size_t>(size.width) * CV_ELEM_SIZE(type);
+    if(m_stride < rowBytes){
+        throw(std::invalid_argument("Stride cannot be smaller than a row of the raw image"));
+    }
+
+    //Chunks are wrapped by cv::Mat headers without copying, so the rows should be aligned to the elements
+    const size_t elementSize = CV_ELEM_SIZE1(type);
+    if(m_stride % elementSize != 0 || m_offset % elementSize != 0){
+        throw(std::invalid_argument("Stride and offset should be multiples of the element size"));
+    }
+
+    std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+    if(!file){
+        throw(std::runtime_error("Raw image file cannot be opened: " + m_path));
+    }
+
+    const size_t requiredSize = m_offset + ((size.height - 1) * m_stride) + rowBytes;
+    if(static_cast<size_t>(file.tellg()) < requiredSize){
+        throw(std::invalid_argument("Raw image file is smaller than the given shape: " + m_path));
+    }
+}
+
+void RawImageSource::setChunkSize(const size_t bytes)
+{
+    m_chunkSize = bytes;
+}
+
+void RawImageSource::setParallelism(const int parallelism)
+{
+    if(parallelism < 0){
+        throw(std::invalid_argument("Maximum number of threads cannot be negative"));
+    }
+
+    m_parallelism = parallelism;
+}
+
+std::pair<double, double> RawImageSource::minMax() const
+{
+    std::pair<double, double> extremes{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    forEachChunk([&](const cv::Mat& chunk){ HistogramBinning::extendMinMax(chunk, extremes, m_parallelism); });
+
+    //Like cv::minMaxLoc, zero is reported if the image has no comparable values at all
+    if(extremes.first > extremes.second)
+        return {0.0, 0.0};
+
+    return extremes;
+}
+
+std::vector<size_t> RawImageSource::countBins(const size_t binCount, const float binStart, const float binEnd, HistogramBinning::RejectedValues *rejected) const
+{
+    if(binCount == 0){
+        throw(std::invalid_argument("number of bins cannot be zero"));
+    }
+
+    std::vector<size_t> counts(binCount, 0);
+    forEachChunk([&](const cv::Mat& chunk){ HistogramBinning::accumulateCounts(chunk, binStart, binEnd, counts, m_parallelism, rejected); });
+    return counts;
+}
+
+Histogram RawImageSource::createHistogram(const std::optional<int> binSize, const std::optional<float> binStart, const std::optional<float> binEnd) const
+{
+    //Fail before the file is read
+    if(binSize && *binSize == 0){
+        throw(std::invalid_argument("number of bins cannot be zero"));
+    }
+
+    std::vector<size_t> counts;
+    HistogramBinning::BinRange range;
+    const int depth = CV_MAT_DEPTH(m_type);
+    if((depth == CV_8U || depth == CV_16U) && CV_MAT_CN(m_type) == 1){
+        //A single pass counts every possible value, both the range and the bins are derived from the table
+        std::vector<size_t> valueCounts;
+        forEachChunk([&](const cv::Mat& chunk){
+            const std::vector<size_t> chunkCounts = HistogramBinning::valueCounts(chunk, m_parallelism);
+            valueCounts.resize(chunkCounts.size(), 0);
+            std::transform(valueCounts.begin(), valueCounts.end(), chunkCounts.begin(), valueCounts.begin(), std::plus<size_t>());
+        });
+
+        range = HistogramBinning::resolveBinRange(HistogramBinning::minMax(valueCounts), binSize, binStart, binEnd);
+        counts = HistogramBinning::foldValueCounts(valueCounts, range.binCount, range.binStart, range.binEnd);
+    }
+    else{
+        //The extremes are found by a separate pass only if the range isn't given
+        const std::pair<double, double> extremes = (!binStart || !binEnd)? minMax() : std::pair<double, double>{};
+        range = HistogramBinning::resolveBinRange(extremes, binSize, binStart, binEnd);
+        counts = countBins(range.binCount, range.binStart, range.binEnd);
+    }
+
+    return Histogram(std::move(counts), range.binStart, range.binEnd);
+}
+
+void RawImageSource::forEachChunk(const std::function<void (const cv::Mat &)> &functor) const
+{
+    if(m_mode == AccessMode::MemoryMap)
+        mapChunks(functor);
+    else
+        streamChunks(functor);
+}
+
+void RawImageSource::mapChunks(const std::function<void (const cv::Mat &)> &functor) const
+{
+#if RAWIMAGESOURCE_MMAP
+    const FileDescriptor file(m_path);
+    if(file.descriptor < 0){
+        throw(std::runtime_error("Raw image file cannot be opened: " + m_path));
+    }
+
+    //Mappings should start at page boundaries, so each chunk is mapped from the page that contains its first byte
+    const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t rowBytes = static_cast<size_t>(m_size.width) * CV_ELEM_SIZE(m_type);
+    const int rowsPerChunk = chunkRows();
+    for(int row = 0; row < m_size.height; row += rowsPerChunk){
+        const int rows = std::min(rowsPerChunk, m_size.height - row);
+        const size_t chunkBegin = m_offset + (row * m_stride);
+        const size_t mapBegin = chunkBegin - (chunkBegin % pageSize);
+        const size_t chunkLength = ((rows - 1) * m_stride) + rowBytes;
+
+        //Only a single chunk is mapped at a time, so the resident memory is bounded by the chunk size
+        const MappedRegion region(file.descriptor, mapBegin, chunkLength + (chunkBegin - mapBegin));
+        if(region.address == MAP_FAILED){
+            throw(std::runtime_error("Raw image file cannot be memory mapped: " + m_path));
+        }
+        ::madvise(region.address, region.length, MADV_WILLNEED);
+
+        uchar* chunkData = static_cast<uchar*>(region.address) + (chunkBegin - mapBegin);
+        functor(cv::Mat(rows, m_size.width, m_type, chunkData, m_stride));
+    }
+#else
+    streamChunks(functor);
+#endif
+}
+
+void RawImageSource::streamChunks(const std::function<void (const cv::Mat &)> &functor) const
+{
+    std::ifstream file(m_path, std::ios::binary);
+    if(!file){
+        throw(std::runtime_error("Raw image file cannot be opened: " + m_path));
+    }
+
+    //Every chunk is read into the same buffer, the padding of the last row of a chunk isn't read
+    const size_t rowBytes = static_cast<size_t>(m_size.width) * CV_ELEM_SIZE(m_type);
+    const int rowsPerChunk = chunkRows();
+    std::vector<uchar> buffer(rowsPerChunk * m_stride);
+    for(int row = 0; row < m_size.height; row += rowsPerChunk){
+        const int rows = std::min(rowsPerChunk, m_size.height - row);
+        const size_t chunkLength = ((rows - 1) * m_stride) + rowBytes;
+
+        file.seekg(static_cast<std::streamoff>(m_offset + (row * m_stride)));
+        file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(chunkLength));
+        if(!file){
+            throw(std::runtime_error("Raw image file cannot be read: " + m_path));
+        }
+
+        functor(cv::Mat(rows, m_size.width, m_type, buffer.data(), m_stride));
+    }
+}
+
+int RawImageSource::chunkRows() const
+{
+    return static_cast<int>(std::clamp<size_t>(m_chunkSize / m_stride, 1, m_size.height));
+}
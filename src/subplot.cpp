@@ -1,5 +1,7 @@
 #include "subplot.h"
-#include <numeric>
+#include <functional>
+#include <mutex>
+#include "opencv2/core/utility.hpp"
 
 
 
@@ -11,72 +13,142 @@ namespace {
     constexpr int PADDING_TITLE_SUBPLOT = 10;
 
 
-    auto getPlottableCanvasSize(Plottable element) -> cv::Size
+    //Calls the functor for every index in [0, count). Independent indices are processed concurrently by at most "parallelism" threads.
+    //If any call throws, the exception of the smallest index is rethrown, so the outcome doesn't depend on the scheduling
+    void parallelForEach(const size_t count, const int parallelism, const std::function<void(size_t)>& functor)
     {
-        const auto lambda_getCanvasSize = [](const auto& element)-> cv::Size {return element.getCanvasSize();};
-        return std::visit(lambda_getCanvasSize, element);
-    }
-
-    auto getReshapedElement(const Plottable& element, const cv::Size newShape) -> cv::Mat
-    {
-        const auto lambda_getClone = [](const auto& element) -> Plottable {return element.clone(); };
-        const auto lambda_reshapeElement = [newShape](auto& element) {element.setCanvasSize(newShape); element.generate(); };
-        const auto lambda_getCanvas = [](const auto& element) -> cv::Mat {return element.canvas(); };
+        if(parallelism == 1 || count < 2){
+            for(size_t index = 0; index < count; index++){
+                functor(index);
+            }
+            return;
+        }
 
-        //Clone the current element
-        Plottable c_element = std::visit(lambda_getClone, element);
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        size_t errorIndex = count;
+        const auto lambda_processRange = [&](const cv::Range& range){
+            for(int index = range.start; index < range.end; index++){
+                try{
+                    functor(static_cast<size_t>(index));
+                }
+                catch(...){
+                    std::lock_guard lock(errorMutex);
+                    if(static_cast<size_t>(index) < errorIndex){
+                        errorIndex = index;
+                        error = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        //Each stripe is processed by a single thread, so the number of stripes caps the number of threads in use
+        const double nstripes = (parallelism > 0)? static_cast<double>(std::min<size_t>(parallelism, count)) : -1.0;
+        cv::parallel_for_(cv::Range(0, static_cast<int>(count)), lambda_processRange, nstripes);
+
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
 
-        //Reshape the current element
-        std::visit(lambda_reshapeElement, c_element);
 
-        return std::visit(lambda_getCanvas, c_element);
+Subplot::Subplot(const std::vector<Plottable> &plotElements, const size_t rows, const size_t cols) :
+    m_rows(rows),
+    m_cols(cols)
+{
+    m_plotElements.reserve(plotElements.size());
+    for(const Plottable& element : plotElements){
+        m_plotElements.emplace_back(std::make_shared<Plottable>(element));
     }
+    validateElements();
 }
 
+Subplot::Subplot(std::vector<Plottable> &&plotElements, const size_t rows, const size_t cols) :
+    m_rows(rows),
+    m_cols(cols)
+{
+    //Moving the elements only transfers the buffers of their vectors and matrices
+    m_plotElements.reserve(plotElements.size());
+    for(Plottable& element : plotElements){
+        m_plotElements.emplace_back(std::make_shared<Plottable>(std::move(element)));
+    }
+    validateElements();
+}
 
-Subplot::Subplot(const std::vector<Plottable> &plotElements, const size_t rows, const size_t cols) :
+Subplot::Subplot(std::vector<std::shared_ptr<Plottable>> plotElements, const size_t rows, const size_t cols) :
     m_rows(rows),
     m_cols(cols),
-    m_plotElements(plotElements)
+    m_plotElements(std::move(plotElements))
+{
+    validateElements();
+}
+
+void Subplot::validateElements()
 {
     //Total number of elements should always be equal to subplot rows * cols
-    if(rows * cols != plotElements.size()){
+    if(m_rows * m_cols != m_plotElements.size()){
         throw std::runtime_error("number of rows and columns should match with the number of plot elements");
     }
-    if(plotElements.empty()){
+    if(m_plotElements.empty()){
         throw std::runtime_error("number of plot elements cannot be zero");
     }
+    if(std::any_of(m_plotElements.begin(), m_plotElements.end(), [](const auto& element){ return !element; })){
+        throw std::invalid_argument("plot element handles cannot be null");
+    }
 }
 
-auto Subplot::generate() -> cv::Mat
+void Subplot::collectElements(std::vector<const Plottable*>& elements) const
 {
-    //Generate all plot if they aren't previously been generated.
-    const auto lambda_generate_if_empty = [](auto& curCanvas){ if(curCanvas.empty()){curCanvas.generate();} };
-    for(Plottable& curCanvas : m_plotElements){
-        std::visit(lambda_generate_if_empty, curCanvas);
+    for(const auto& element : m_plotElements){
+        elements.push_back(element.get());
+        if(const Subplot* nestedSubplot = std::get_if<Subplot>(element.get())){
+            nestedSubplot->collectElements(elements);
+        }
     }
+}
 
-    //Determine the largest canvas size that can fit all available input plots
-    const std::vector<int> largestRows = getLargestRows();
-    const std::vector<int> largestColumns = getLargestColumns();
+bool Subplot::hasRepeatedElements() const
+{
+    //An element that is placed into multiple cells, including the cells of the nested subplots, cannot be rendered into them concurrently.
+    //Handles can be reassigned, so the elements are collected for every render
+    std::vector<const Plottable*> elements;
+    collectElements(elements);
+    std::sort(elements.begin(), elements.end());
+    return std::adjacent_find(elements.begin(), elements.end()) != elements.end();
+}
 
-    auto a = largestColumns.cbegin();
+auto Subplot::generate() -> cv::Mat
+{
+    //Neither the subplot nor its elements have changed since the last render
+    if(isCanvasUpToDate(revision()))
+        return m_canvas;
+
+    //Each render provides a new canvas, so that the previously returned canvases stay intact. Only the canvases that the subplot has
+    //allocated are kept, the buffers of the callers can be modified by them at any time
+    const uint64_t currentRevision = revision();
+    cv::Mat out;
+    generate(out);
+    m_canvas = out;
+    markRendered(currentRevision);
+    return out;
+}
 
-    //Initialize a row counter
-    int rowCounter = CANVAS_HEIGHT_PADDING;
+void Subplot::generate(cv::Mat &out)
+{
 
-    //Generate the title but don't place it on the canvas yet. Size of these canvases will determine the size of the main canvas
-    cv::Mat titleCanvas = (m_title.empty()) ? cv::Mat() : generateText(m_titleSize, m_title, m_titleColor);
+    //Arrange the grid without rendering anything. Unless the cells have a fixed size, it's determined by the largest elements of each row and column
+    const GridLayout layout = arrangeGrid();
+
+    //Measure the title but don't render it yet. Size of the title will determine the size of the main canvas
+    const cv::Size titleCanvasSize = (m_title.empty()) ? cv::Size() : measureText(m_titleSize, m_title);
 
     //There is a lower limit on the sizes that a canvas can have
-    const int totalColWidth = std::reduce(largestColumns.begin(), largestColumns.end());
-    const int totalRowHeight = std::reduce(largestRows.begin(), largestRows.end());
-    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvas.size(), totalRowHeight, totalColWidth);
+    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvasSize, layout.size().height, layout.size().width);
     canvasSize.height = std::max(canvasSize.height, minimumCanvasSize.height);
     canvasSize.width = std::max(canvasSize.width, minimumCanvasSize.width);
 
-    //Generate a blank canvas
-    m_canvas = cv::Mat(canvasSize, CV_8UC3, white);
+    //Prepare a blank canvas on the caller's buffer
+    prepareCanvas(out);
 
     //This counter keeps track of the last row position on the canvas
     int canvasRowCounter = 0;
@@ -84,28 +156,62 @@ auto Subplot::generate() -> cv::Mat
     //Add top padding to the row counter
     canvasRowCounter += CANVAS_HEIGHT_PADDING;
 
-    //Reshape the previously generated title and place it on the canvas
-    if (!titleCanvas.empty()) {
-        centerElement(titleCanvas, cv::Size{ canvasSize.width, 0 }, AlignmentType::WidthOnly);
-        titleCanvas.copyTo(m_canvas.rowRange(canvasRowCounter, canvasRowCounter + titleCanvas.rows));
+    //Render the title, reshape it and place it on the canvas
+    if (!m_title.empty()) {
+        const cv::Mat titleCanvas = generateText(m_titleSize, m_title, m_titleColor);
+        placeElement(titleCanvas, out, cv::Rect(0, canvasRowCounter, canvasSize.width, titleCanvas.rows), AlignmentType::WidthOnly);
 
         canvasRowCounter += titleCanvas.rows + PADDING_TITLE_SUBPLOT;
     }
 
-    //Reshape each element, then place it on the canvas
-    for (int r = 0; r < m_rows; r++) {
-        for (int c = 0; c < m_cols; c++) {
-            const Plottable& curElement = m_plotElements.at((r * m_cols) + c);
-            cv::Mat& curCanvas = getReshapedElement(curElement, { largestColumns.at(c), largestRows.at(r)});
+    //Render each element exactly once, directly on its area of the canvas.
+    //Areas don't overlap, so the cells are rendered concurrently and the result is identical to the serial rendering
+    const int parallelism = (m_parallelism == 1 || hasRepeatedElements())? 1 : m_parallelism;
+    parallelForEach(m_plotElements.size(), parallelism, [&](const size_t index){
+        const cv::Rect targetArea = layout.cellArea(index) + cv::Point{CANVAS_WIDTH_PADDING, canvasRowCounter};
+        cv::Mat curCanvas = out(targetArea);
+        renderElementInto(*m_plotElements[index], targetArea.size(), curCanvas);
+    });
+}
 
-            const int accumulatedWidth = std::reduce(largestColumns.begin(), largestColumns.begin() + c);
-            const int accumulatedHeight = std::reduce(largestRows.begin(), largestRows.begin() + r);
-            const cv::Rect targetArea{CANVAS_WIDTH_PADDING + accumulatedWidth, canvasRowCounter + accumulatedHeight, largestColumns.at(c), largestRows.at(r)};
-            curCanvas.copyTo(m_canvas(targetArea));
-        }
+cv::Size Subplot::requiredCanvasSize()
+{
+    const cv::Size gridSize = arrangeGrid().size();
+    const cv::Size titleCanvasSize = (m_title.empty()) ? cv::Size() : measureText(m_titleSize, m_title);
+    const cv::Size minimumCanvasSize = calculateMinimumCanvasSize(titleCanvasSize, gridSize.height, gridSize.width);
+
+    return cv::Size{std::max(canvasSize.width, minimumCanvasSize.width), std::max(canvasSize.height, minimumCanvasSize.height)};
+}
+
+void Subplot::setCellSize(const std::optional<cv::Size> cellSize)
+{
+    if(cellSize && (cellSize->width < 0 || cellSize->height < 0))
+        throw std::invalid_argument("Cell size cannot be negative");
+
+    if(m_fixedCellSize != cellSize){
+        m_fixedCellSize = cellSize;
+        markModified();
     }
+}
+
+void Subplot::setParallelism(const int maxThreads)
+{
+    if(maxThreads < 0)
+        throw std::invalid_argument("Maximum number of threads cannot be negative");
+
+    m_parallelism = maxThreads;
+}
+
+uint64_t Subplot::revision() const
+{
+    //Subplot has to be drawn again if any of its elements has been modified
+    const auto lambda_getRevision = [](const auto& element) -> uint64_t {return element.revision();};
 
-    return m_canvas;
+    uint64_t out = m_revision.value;
+    for(const auto& element : m_plotElements){
+        out = std::max(out, std::visit(lambda_getRevision, *element));
+    }
+    return out;
 }
 
 cv::Size Subplot::calculateMinimumCanvasSize(const cv::Size &titleCanvasSize, const int totalRowHeight, const int totalColWidth) const
@@ -119,52 +225,66 @@ cv::Size Subplot::calculateMinimumCanvasSize(const cv::Size &titleCanvasSize, co
     return cv::Size{totalWidth, totalHeight};
 }
 
-std::vector<int> Subplot::getLargestRows() const
+std::vector<cv::Size> Subplot::requiredElementSizes()
 {
-    const auto lambda_compareVectorHeight = [](const Plottable first, const Plottable second) -> bool {
-        return getPlottableCanvasSize(first).height < getPlottableCanvasSize(second).height;
-    };
-    std::vector<int>out;
-    out.reserve(m_rows);
+    const auto lambda_requiredCanvasSize = [](auto& element) -> cv::Size {return element.requiredCanvasSize();};
 
-    for (auto it = m_plotElements.cbegin(); it != m_plotElements.end(); it += m_cols) {
-        const int largestHeight = getPlottableCanvasSize(*std::max_element(it, it + m_cols, lambda_compareVectorHeight)).height;
-        out.emplace_back(largestHeight);
+    std::vector<cv::Size> out;
+    out.reserve(m_plotElements.size());
+    for(const auto& element : m_plotElements){
+        out.emplace_back(std::visit(lambda_requiredCanvasSize, *element));
     }
     return out;
 }
 
-std::vector<int> Subplot::getLargestColumns() const
+GridLayout Subplot::arrangeGrid()
 {
-    const auto lambda_compareVectorWidth = [](const Plottable* first, const Plottable* second) -> bool {
-        return getPlottableCanvasSize(*first).width < getPlottableCanvasSize(*second).width;
-    };
+    GridLayout layout(m_rows, m_cols);
+    if(m_fixedCellSize){
+        layout.arrange(*m_fixedCellSize);
+    }
+    else{
+        layout.arrange(requiredElementSizes());
+    }
+    return layout;
+}
 
-    std::vector<int>out;
-    out.reserve(m_cols);
+void Subplot::renderElementInto(Plottable &element, const cv::Size &cellSize, cv::Mat &target)
+{
+    //The element is rendered with the size of its cell, then its own canvas size is restored. The element itself isn't modified,
+    //so the canvas size is changed without assigning a new revision. The cell belongs to the subplot canvas, the element doesn't keep it
+    const auto lambda_renderElement = [&cellSize, &target](auto& element) {
+        PlotElementBase& base = element;
+        const cv::Size elementCanvasSize = base.canvasSize;
+        base.canvasSize = cellSize;
+
+        try{
+            element.generate(target);
+        }
+        catch(...){
+            base.canvasSize = elementCanvasSize;
+            throw;
+        }
+        base.canvasSize = elementCanvasSize;
+    };
 
-    for (int c = 0; c < m_cols; c++) {
-        std::vector<const Plottable*> columnElements;
-        columnElements.reserve(m_rows);
+    const uchar* targetData = target.data;
+    std::visit(lambda_renderElement, element);
 
-        for (int r = 0; r < m_rows; r++) {
-            const int index = r * m_cols + c; 
-            columnElements.push_back(&m_plotElements.at(index));
-        }
-        
-        const int largestWidth = getPlottableCanvasSize(**std::max_element(columnElements.begin(), columnElements.end(), lambda_compareVectorWidth)).width;
-        out.emplace_back(largestWidth);
-    }
-    return out;
+    if(target.data != targetData)
+        throw std::runtime_error("Plot element doesn't fit into its subplot area");
 }
 
 Subplot Subplot::clone() const
 {
-    //Clone all cv::Mat types and copy everything else
+    //Clone all cv::Mat types and the elements, copy everything else
+    const auto lambda_getClone = [](const auto& element) -> Plottable {return element.clone(); };
+
     Subplot out(*this);
     out.m_canvas = m_canvas.clone();
+    for(auto& element : out.m_plotElements){
+        element = std::make_shared<Plottable>(std::visit(lambda_getClone, *element));
+    }
 
     return out;
 }
-
-
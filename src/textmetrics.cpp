@@ -0,0 +1,51 @@
+#include "textmetrics.h"
+#include "opencv2/imgproc.hpp"
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+
+const TextMetrics::FontMetrics& TextMetrics::fontMetrics(const int font)
+{
+    static std::mutex mutex;
+    static std::map<int, FontMetrics> metricsTable;
+
+    std::lock_guard lock(mutex);
+    const auto it = metricsTable.find(font);
+    if(it != metricsTable.end())
+        return it->second;
+
+    //Hershey metrics are integers in font units, measuring with unit scale and zero thickness gives them exactly
+    FontMetrics metrics;
+    for(int glyph = FIRST_GLYPH; glyph <= LAST_GLYPH; glyph++){
+        int baseline = 0;
+        const cv::Size glyphSize = cv::getTextSize(cv::String(1, static_cast<char>(glyph)), font, 1.0, 0, &baseline);
+        metrics.advanceUnits[glyph - FIRST_GLYPH] = glyphSize.width;
+        metrics.heightUnits = glyphSize.height;
+        metrics.baselineUnits = baseline;
+    }
+
+    //std::map never relocates its nodes, so the returned reference stays valid
+    return metricsTable.emplace(font, metrics).first->second;
+}
+
+cv::Size TextMetrics::textSize(const std::string_view text, const double fontScale, const int font, const int thickness, int *baseline)
+{
+    const auto lambda_isHersheyGlyph = [](const char glyph){ return glyph >= FIRST_GLYPH && glyph <= LAST_GLYPH; };
+
+    //Multi-byte characters are handled by OpenCV itself
+    if(!std::all_of(text.begin(), text.end(), lambda_isHersheyGlyph))
+        return cv::getTextSize(cv::String{text.data(), text.size()}, font, fontScale, thickness, baseline);
+
+    //Accumulate in the same order and with the same rounding rules as cv::getTextSize, so that the results are identical
+    const FontMetrics& metrics = fontMetrics(font);
+    double advance = 0;
+    for(const char glyph : text){
+        advance += metrics.advanceUnits[glyph - FIRST_GLYPH] * fontScale;
+    }
+
+    if(baseline)
+        *baseline = cvRound((metrics.baselineUnits * fontScale) + (thickness * 0.5));
+
+    return cv::Size{cvRound(advance + thickness), cvRound((metrics.heightUnits * fontScale) + ((thickness + 1) / 2))};
+}
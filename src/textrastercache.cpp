@@ -0,0 +1,104 @@
+#include "textrastercache.h"
+#include <functional>
+
+
+TextRasterCache& TextRasterCache::instance()
+{
+    static TextRasterCache cache;
+    return cache;
+}
+
+bool TextRasterCache::Key::operator==(const Key &other) const
+{
+    return (text == other.text) && (fontSize == other.fontSize) && (color == other.color) && (font == other.font);
+}
+
+size_t TextRasterCache::KeyHash::operator()(const Key &key) const
+{
+    //Combine the hashes of each key member
+    size_t seed = std::hash<std::string_view>{}(key.text);
+    const auto lambda_combine = [&seed](const size_t value){ seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+
+    lambda_combine(std::hash<float>{}(key.fontSize));
+    lambda_combine(std::hash<int>{}(key.font));
+    for(int ch = 0; ch < 4; ch++){
+        lambda_combine(std::hash<double>{}(key.color[ch]));
+    }
+    return seed;
+}
+
+void TextRasterCache::setCapacity(const size_t capacity)
+{
+    std::lock_guard lock(m_mutex);
+    m_capacity = capacity;
+    evictExcess();
+}
+
+size_t TextRasterCache::capacity() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_capacity;
+}
+
+size_t TextRasterCache::size() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_entries.size();
+}
+
+void TextRasterCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void TextRasterCache::clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_lookup.clear();
+    m_entries.clear();
+}
+
+bool TextRasterCache::find(const Key &key, cv::Mat &out)
+{
+    std::lock_guard lock(m_mutex);
+
+    const auto it = m_lookup.find(key);
+    if(it == m_lookup.end()){
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    //Move the entry to the front to mark it as the most recently used one
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    out = it->second->canvas;
+
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void TextRasterCache::insert(const Key &key, const cv::Mat &canvas)
+{
+    std::lock_guard lock(m_mutex);
+
+    //Disabled cache or another thread has already inserted the same key
+    if(m_capacity == 0 || m_lookup.count(key) != 0)
+        return;
+
+    m_entries.push_front(Entry{std::string(key.text), key.fontSize, key.color, key.font, canvas});
+
+    //The stored key refers to the string that is owned by the entry, list nodes never relocate
+    const Entry& entry = m_entries.front();
+    m_lookup.emplace(Key{entry.text, entry.fontSize, entry.color, entry.font}, m_entries.begin());
+
+    evictExcess();
+}
+
+void TextRasterCache::evictExcess()
+{
+    while(m_entries.size() > m_capacity){
+        const Entry& leastRecent = m_entries.back();
+        m_lookup.erase(Key{leastRecent.text, leastRecent.fontSize, leastRecent.color, leastRecent.font});
+        m_entries.pop_back();
+    }
+}
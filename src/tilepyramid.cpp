@@ -0,0 +1,195 @@
+#include "tilepyramid.h"
+#include "histogrambinning.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+    //Level, row and column of a tile are packed into a single key
+    uint64_t tileKey(const int level, const int column, const int row)
+    {
+        return (static_cast<uint64_t>(level) << 56) | (static_cast<uint64_t>(row) << 28) | static_cast<uint64_t>(column);
+    }
+
+    //Number of the pixels that cover "length" pixels of the level above
+    int halved(const int length)
+    {
+        return (length + 1) / 2;
+    }
+}
+
+TilePyramid::TilePyramid(const cv::Mat &source, const std::optional<double> lower, const std::optional<double> upper, const Downsampling downsampling, const int tileSize) :
+    m_source(source),
+    m_downsampling((downsampling == Downsampling::None)? Downsampling::Nearest : downsampling),
+    m_tileSize(tileSize)
+{
+    if(source.empty() || source.channels() != 1 || source.dims > 2){
+        throw(std::invalid_argument("Source of the pyramid should be a non-empty single channel array with two dimensions"));
+    }
+    if(tileSize <= 0){
+        throw(std::invalid_argument("Size of the tiles should be positive"));
+    }
+
+    //The source is only searched for the bounds that aren't given
+    const std::pair<double, double> extremes = (!lower || !upper)? HistogramBinning::minMax(source) : std::pair<double, double>{};
+    m_lower = lower.value_or(extremes.first);
+    m_upper = upper.value_or(extremes.second);
+    if(m_lower > m_upper){
+        throw(std::invalid_argument("Minimum colormap bound should not be larger than the maximum bound"));
+    }
+
+    //The last level fits into a single tile
+    m_levelCount = 1;
+    for(cv::Size size = source.size(); std::max(size.width, size.height) > tileSize; size = cv::Size(halved(size.width), halved(size.height))){
+        m_levelCount++;
+    }
+}
+
+void TilePyramid::render(const cv::Rect &sourceRect, const cv::Size &size, cv::Mat &out)
+{
+    if(sourceRect.empty() || (sourceRect & cv::Rect(cv::Point(), m_source.size())) != sourceRect){
+        throw(std::invalid_argument("Viewport should be a non-empty rectangle within the source"));
+    }
+    if(size.width <= 0 || size.height <= 0){
+        throw(std::invalid_argument("Output size should be positive"));
+    }
+
+    //The coarsest level that still has at least as many pixels as the output in both directions
+    const double sourcePixelsPerOutputPixel = std::min(static_cast<double>(sourceRect.width) / size.width, static_cast<double>(sourceRect.height) / size.height);
+    int level = 0;
+    while(level + 1 < m_levelCount && sourcePixelsPerOutputPixel >= static_cast<double>(int64_t{2} << level)){
+        level++;
+    }
+
+    //Viewport on the chosen level, extended outwards to whole pixels of the level
+    const cv::Size currentLevelSize = levelSize(level);
+    const int x0 = sourceRect.x >> level;
+    const int y0 = sourceRect.y >> level;
+    const int x1 = std::min(static_cast<int>((static_cast<int64_t>(sourceRect.x) + sourceRect.width + (int64_t{1} << level) - 1) >> level), currentLevelSize.width);
+    const int y1 = std::min(static_cast<int>((static_cast<int64_t>(sourceRect.y) + sourceRect.height + (int64_t{1} << level) - 1) >> level), currentLevelSize.height);
+
+    //The region is local to the render, so concurrent renders don't share anything but the cache
+    cv::Mat region;
+    composeLevel(level, cv::Rect(x0, y0, x1 - x0, y1 - y0), region);
+    ColormapKernel::resample(region, size, m_downsampling, out);
+}
+
+void TilePyramid::setCapacity(const size_t capacity)
+{
+    std::lock_guard lock(m_mutex);
+    m_capacity = capacity;
+    evictExcess();
+}
+
+size_t TilePyramid::capacity() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_capacity;
+}
+
+size_t TilePyramid::size() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_tiles.size();
+}
+
+size_t TilePyramid::computedTiles() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_computedTiles;
+}
+
+cv::Size TilePyramid::levelSize(const int level) const
+{
+    cv::Size size = m_source.size();
+    for(int l = 0; l < level; l++){
+        size = cv::Size(halved(size.width), halved(size.height));
+    }
+    return size;
+}
+
+cv::Mat TilePyramid::tile(const int level, const int column, const int row)
+{
+    const uint64_t key = tileKey(level, column, row);
+    {
+        std::lock_guard lock(m_mutex);
+        const auto it = m_lookup.find(key);
+        if(it != m_lookup.end()){
+            //Move the entry to the front to mark it as the most recently used one
+            m_tiles.splice(m_tiles.begin(), m_tiles, it->second);
+            return it->second->tile;
+        }
+    }
+
+    //Tiles of the coarser levels are computed from the tiles below them, which are cached on the way. The computation doesn't hold the lock,
+    //so the tiles below can be looked up and other renders aren't blocked
+    cv::Mat computed = computeTile(level, column, row);
+
+    std::lock_guard lock(m_mutex);
+    m_computedTiles++;
+
+    //Concurrent misses on the same tile compute identical tiles, the one that has been cached first is kept
+    const auto it = m_lookup.find(key);
+    if(it != m_lookup.end()){
+        m_tiles.splice(m_tiles.begin(), m_tiles, it->second);
+        return it->second->tile;
+    }
+
+    if(m_capacity > 0){
+        m_tiles.push_front(Entry{key, computed});
+        m_lookup[key] = m_tiles.begin();
+        evictExcess();
+    }
+    return computed;
+}
+
+cv::Mat TilePyramid::computeTile(const int level, const int column, const int row)
+{
+    const cv::Size currentLevelSize = levelSize(level);
+    const cv::Rect tileRect(column * m_tileSize, row * m_tileSize,
+                            std::min(m_tileSize, currentLevelSize.width - (column * m_tileSize)),
+                            std::min(m_tileSize, currentLevelSize.height - (row * m_tileSize)));
+
+    cv::Mat computed;
+    if(level == 0){
+        ColormapKernel::quantize(m_source(tileRect), m_lower, m_upper, computed, 1);
+        return computed;
+    }
+
+    //The four tiles below cover twice the rectangle of the tile
+    const cv::Size lowerLevelSize = levelSize(level - 1);
+    const cv::Rect lowerRect(2 * tileRect.x, 2 * tileRect.y,
+                             std::min(2 * m_tileSize, lowerLevelSize.width - (2 * tileRect.x)),
+                             std::min(2 * m_tileSize, lowerLevelSize.height - (2 * tileRect.y)));
+
+    cv::Mat lowerTiles;
+    composeLevel(level - 1, lowerRect, lowerTiles);
+    ColormapKernel::resample(lowerTiles, tileRect.size(), m_downsampling, computed);
+    return computed;
+}
+
+void TilePyramid::composeLevel(const int level, const cv::Rect &levelRect, cv::Mat &out)
+{
+    out.create(levelRect.size(), CV_8U);
+
+    const int firstColumn = levelRect.x / m_tileSize;
+    const int lastColumn = (levelRect.x + levelRect.width - 1) / m_tileSize;
+    const int firstRow = levelRect.y / m_tileSize;
+    const int lastRow = (levelRect.y + levelRect.height - 1) / m_tileSize;
+    for(int row = firstRow; row <= lastRow; row++){
+        for(int column = firstColumn; column <= lastColumn; column++){
+            const cv::Mat currentTile = tile(level, column, row);
+            const cv::Rect tileRect(column * m_tileSize, row * m_tileSize, currentTile.cols, currentTile.rows);
+            const cv::Rect overlap = tileRect & levelRect;
+            currentTile(overlap - tileRect.tl()).copyTo(out(overlap - levelRect.tl()));
+        }
+    }
+}
+
+void TilePyramid::evictExcess()
+{
+    while(m_tiles.size() > m_capacity){
+        m_lookup.erase(m_tiles.back().key);
+        m_tiles.pop_back();
+    }
+}